@@ -0,0 +1,103 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <mvd/streams.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Measures the per-event cost of pushing events into a stream with 4 observers from 1 to 32
+// producer threads concurrently, for each of the thread-safe access policies.
+// (access_policy::none and thread_confined don't support concurrent producers)
+
+namespace
+{
+  template< typename access_policy_t >
+  struct counting_observer : mvd::streams::basic_observer< int, access_policy_t >
+  {
+    void on_event( int& e_ ) override { sum.fetch_add( static_cast< std::uint64_t >( e_ ), std::memory_order_relaxed ); }
+    void on_done() override {}
+
+    std::atomic< std::uint64_t > sum{ 0 };
+  };
+
+
+  template< typename access_policy_t >
+  double measure_ns_per_event( size_t producerCount_, size_t eventsPerProducer_ )
+  {
+    mvd::streams::basic_stream< int, access_policy_t > stream;
+    auto observers = std::vector< counting_observer< access_policy_t > >( 4 );
+    for( auto& o : observers )
+      stream.subscribe( o );
+
+    std::atomic< bool > go{ false };
+    auto producers = std::vector< std::thread >();
+    for( size_t i = 0; i < producerCount_; ++i )
+    {
+      producers.emplace_back( [&stream, &go, eventsPerProducer_]()
+      {
+        while( !go.load() )
+          std::this_thread::yield();
+
+        for( size_t j = 0; j < eventsPerProducer_; ++j )
+          stream << static_cast< int >( j );
+      });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store( true );
+    for( auto& p : producers )
+      p.join();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration< double, std::nano >( end - start ).count() / ( producerCount_ * eventsPerProducer_ );
+  }
+}
+
+
+int main( int, char*[] )
+{
+  using namespace mvd::streams;
+
+  const size_t eventCount = 4000000;
+
+  std::cout << std::setw( 10 ) << "producers"
+            << std::setw( 16 ) << "locked [ns]"
+            << std::setw( 16 ) << "spinning [ns]"
+            << std::setw( 16 ) << "shared [ns]"
+            << std::setw( 16 ) << "cow [ns]" << "\n";
+
+  for( size_t producerCount : { 1u, 2u, 4u, 8u, 16u, 32u } )
+  {
+    const size_t n = eventCount / producerCount;
+
+    std::cout << std::setw( 10 ) << producerCount << std::fixed << std::setprecision( 2 )
+              << std::setw( 16 ) << measure_ns_per_event< access_policy::locked >( producerCount, n )
+              << std::setw( 16 ) << measure_ns_per_event< access_policy::spinning >( producerCount, n )
+              << std::setw( 16 ) << measure_ns_per_event< access_policy::shared_locked >( producerCount, n )
+              << std::setw( 16 ) << measure_ns_per_event< access_policy::copy_on_write >( producerCount, n )
+              << "\n";
+  }
+
+  return 0;
+}
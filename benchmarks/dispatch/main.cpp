@@ -0,0 +1,104 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <mvd/streams.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Measures the per-event cost of basic_stream::operator<< for different observer counts,
+// comparing the templated observer visitation with the former std::function based one.
+
+namespace
+{
+  using access_policy_t = mvd::streams::access_policy::none;
+
+  struct counting_observer : mvd::streams::observer< int >
+  {
+    void on_event( int& e_ ) override { sum += static_cast< std::uint64_t >( e_ ); }
+    void on_done() override {}
+
+    std::uint64_t sum = 0;
+  };
+
+
+  // dispatches like basic_stream did before, i.e. through a std::function
+  struct type_erased_stream : mvd::streams::stream< int >
+  {
+    void push( int e_ )
+    {
+      this->for_each_observer( std::function< void( mvd::streams::observer_base< access_policy_t >& ) >(
+        [&e_]( mvd::streams::observer_base< access_policy_t >& o_ )
+        {
+          static_cast< observer_t& >( o_ ).on_event( e_ );
+        }
+      ));
+    }
+  };
+
+
+  template< typename push_fn_t >
+  double measure_ns_per_event( size_t eventCount_, push_fn_t push_ )
+  {
+    auto start = std::chrono::steady_clock::now();
+    for( size_t i = 0; i < eventCount_; ++i )
+      push_( static_cast< int >( i ) );
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration< double, std::nano >( end - start ).count() / eventCount_;
+  }
+}
+
+
+int main( int, char*[] )
+{
+  const size_t eventCount = 10000000;
+
+  std::cout << std::setw( 10 ) << "observers"
+            << std::setw( 22 ) << "std::function [ns]"
+            << std::setw( 22 ) << "template [ns]" << "\n";
+
+  for( size_t observerCount : { 1u, 4u, 64u } )
+  {
+    // an observer can only observe one stream at a time
+    auto typeErasedObservers = std::vector< counting_observer >( observerCount );
+    auto templatedObservers = std::vector< counting_observer >( observerCount );
+
+    type_erased_stream typeErased;
+    for( auto& o : typeErasedObservers )
+      typeErased.subscribe( o );
+
+    mvd::streams::stream< int > templated;
+    for( auto& o : templatedObservers )
+      templated.subscribe( o );
+
+    const size_t n = eventCount / observerCount;
+    auto typeErasedNs = measure_ns_per_event( n, [&typeErased]( int e_ ) { typeErased.push( e_ ); } );
+    auto templatedNs = measure_ns_per_event( n, [&templated]( int e_ ) { templated << e_; } );
+
+    std::cout << std::setw( 10 ) << observerCount
+              << std::setw( 22 ) << std::fixed << std::setprecision( 2 ) << typeErasedNs
+              << std::setw( 22 ) << templatedNs << "\n";
+  }
+
+  return 0;
+}
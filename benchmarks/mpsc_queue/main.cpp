@@ -0,0 +1,155 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <mvd/streams.h>
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Measures the throughput of an async stream fed by 1 to 32 producer threads and drained by
+// one dispatcher thread, comparing mpsc_queue with a default_queue guarded by a mutex.
+// Producers retry while the queue is full so no events are dropped.
+
+namespace
+{
+  template< typename event_t >
+  class locked_queue
+  {
+  public:
+
+    locked_queue( size_t capacity_ ) : m_queue( capacity_ ) {}
+
+    bool push( event_t e_ )
+    {
+      for( ;; )
+      {
+        {
+          std::lock_guard< std::mutex > l( m_mutex );
+          if( m_queue.push( std::move( e_ ) ) )
+            return true;
+        }
+        std::this_thread::yield();
+      }
+    }
+
+    template< typename fn_t >
+    bool consume_one( fn_t&& fn_ )
+    {
+      std::lock_guard< std::mutex > l( m_mutex );
+      return m_queue.consume_one( std::forward< fn_t >( fn_ ) );
+    }
+
+  private:
+
+    mvd::streams::default_queue< event_t > m_queue;
+    std::mutex m_mutex;
+  };
+
+
+  template< typename event_t >
+  class retrying_mpsc_queue : public mvd::streams::mpsc_queue< event_t >
+  {
+  public:
+
+    using mvd::streams::mpsc_queue< event_t >::mpsc_queue;
+
+    bool push( event_t e_ )
+    {
+      // a failed push leaves e_ untouched
+      while( !mvd::streams::mpsc_queue< event_t >::push( std::move( e_ ) ) )
+        std::this_thread::yield();
+      return true;
+    }
+  };
+
+
+  struct counting_observer : mvd::streams::observer< int >
+  {
+    void on_event( int& ) override { count.fetch_add( 1, std::memory_order_relaxed ); }
+    void on_done() override {}
+
+    std::atomic< size_t > count{ 0 };
+  };
+
+
+  template< template< typename > class queue_t >
+  double measure_ns_per_event( size_t producerCount_, size_t eventsPerProducer_ )
+  {
+    mvd::streams::basic_async_stream< int, mvd::streams::access_policy::none, queue_t > stream( 4096u );
+    counting_observer o;
+    stream.subscribe( o );
+
+    const size_t total = producerCount_ * eventsPerProducer_;
+    std::atomic< bool > go{ false };
+
+    std::thread dispatcher( [&]()
+    {
+      while( o.count.load( std::memory_order_relaxed ) < total )
+        stream.dispatch_events();
+    });
+
+    auto producers = std::vector< std::thread >();
+    for( size_t i = 0; i < producerCount_; ++i )
+    {
+      producers.emplace_back( [&]()
+      {
+        while( !go.load() )
+          std::this_thread::yield();
+
+        for( size_t j = 0; j < eventsPerProducer_; ++j )
+          stream << static_cast< int >( j );
+      });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store( true );
+    for( auto& p : producers )
+      p.join();
+    dispatcher.join();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration< double, std::nano >( end - start ).count() / total;
+  }
+}
+
+
+int main( int, char*[] )
+{
+  const size_t eventCount = 4000000;
+
+  std::cout << std::setw( 10 ) << "producers"
+            << std::setw( 20 ) << "mutex queue [ns]"
+            << std::setw( 20 ) << "mpsc_queue [ns]" << "\n";
+
+  for( size_t producerCount : { 1u, 2u, 4u, 8u, 16u, 32u } )
+  {
+    const size_t n = eventCount / producerCount;
+
+    std::cout << std::setw( 10 ) << producerCount << std::fixed << std::setprecision( 2 )
+              << std::setw( 20 ) << measure_ns_per_event< locked_queue >( producerCount, n )
+              << std::setw( 20 ) << measure_ns_per_event< retrying_mpsc_queue >( producerCount, n )
+              << "\n";
+  }
+
+  return 0;
+}
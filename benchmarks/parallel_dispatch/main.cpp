@@ -0,0 +1,97 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <mvd/streams.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Measures the latency of pushing one event into a stream whose observers each do a fixed
+// amount of independent work, dispatched sequentially and in parallel on a fork_join_pool.
+
+namespace
+{
+  // burns roughly workNs_ of cpu time per event
+  struct busy_observer : mvd::streams::observer< int >
+  {
+    explicit busy_observer( std::chrono::nanoseconds workNs_ = std::chrono::microseconds( 20 ) )
+      : work( workNs_ )
+    {}
+
+    void on_event( int& e_ ) override
+    {
+      auto end = std::chrono::steady_clock::now() + work;
+      while( std::chrono::steady_clock::now() < end )
+        sum += static_cast< std::uint64_t >( e_ );
+    }
+    void on_done() override {}
+
+    std::chrono::nanoseconds work;
+    std::uint64_t sum = 0;
+  };
+
+
+  double measure_us_per_event( mvd::streams::stream< int >& s_, size_t eventCount_ )
+  {
+    auto start = std::chrono::steady_clock::now();
+    for( size_t i = 0; i < eventCount_; ++i )
+      s_ << static_cast< int >( i );
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration< double, std::micro >( end - start ).count() / eventCount_;
+  }
+}
+
+
+int main( int, char*[] )
+{
+  const size_t eventCount = 200;
+  mvd::streams::fork_join_pool pool;
+
+  std::cout << "observer work: 20us, threads: " << pool.concurrency() << "\n";
+  std::cout << std::setw( 10 ) << "observers"
+            << std::setw( 20 ) << "sequential [us]"
+            << std::setw( 20 ) << "parallel [us]" << "\n";
+
+  for( size_t observerCount : { 1u, 4u, 16u, 50u } )
+  {
+    auto sequentialObservers = std::vector< busy_observer >( observerCount );
+    auto parallelObservers = std::vector< busy_observer >( observerCount );
+
+    mvd::streams::stream< int > sequential;
+    for( auto& o : sequentialObservers )
+      sequential.subscribe( o );
+
+    mvd::streams::stream< int > parallel;
+    parallel.set_parallel_dispatch( &pool );
+    for( auto& o : parallelObservers )
+      parallel.subscribe( o );
+
+    auto sequentialUs = measure_us_per_event( sequential, eventCount );
+    auto parallelUs = measure_us_per_event( parallel, eventCount );
+
+    std::cout << std::setw( 10 ) << observerCount
+              << std::setw( 20 ) << std::fixed << std::setprecision( 2 ) << sequentialUs
+              << std::setw( 20 ) << parallelUs << "\n";
+  }
+
+  return 0;
+}
@@ -21,7 +21,20 @@
 #include "streams/basic_stream.h"
 #include "streams/basic_async_stream.h"
 #include "streams/access_policy.h"
+#include "streams/dispatcher.h"
+#include "streams/double_buffered_queue.h"
+#include "streams/fork_join_pool.h"
 #include "streams/operators.h"
+#include "streams/partitioned_stream.h"
+#include "streams/mpsc_queue.h"
+#include "streams/object_pool.h"
+#include "streams/pipeline.h"
+#include "streams/shared_event.h"
+#include "streams/spsc_queue.h"
+#include "streams/static_stream.h"
+#include "streams/time_operators.h"
+#include "streams/timer_wheel.h"
+#include "streams/work_stealing_executor.h"
 
 namespace mvd
 {
@@ -39,6 +52,30 @@ namespace streams
   template< typename event_t >
   using locked_observer = basic_observer< event_t, access_policy::locked >;
 
+  template< typename event_t >
+  using cow_stream = basic_stream< event_t, access_policy::copy_on_write >;
+
+  template< typename event_t >
+  using cow_observer = basic_observer< event_t, access_policy::copy_on_write >;
+
+  template< typename event_t >
+  using spinning_stream = basic_stream< event_t, access_policy::spinning >;
+
+  template< typename event_t >
+  using spinning_observer = basic_observer< event_t, access_policy::spinning >;
+
+  template< typename event_t >
+  using shared_locked_stream = basic_stream< event_t, access_policy::shared_locked >;
+
+  template< typename event_t >
+  using shared_locked_observer = basic_observer< event_t, access_policy::shared_locked >;
+
+  template< typename event_t >
+  using confined_stream = basic_stream< event_t, access_policy::thread_confined >;
+
+  template< typename event_t >
+  using confined_observer = basic_observer< event_t, access_policy::thread_confined >;
+
 
   template< typename event_t >
   using async_stream = basic_async_stream< event_t, access_policy::none >;
@@ -51,5 +88,26 @@ namespace streams
 
   template< typename event_t >
   using async_locked_observer = basic_async_observer< event_t, access_policy::locked >;
+
+  // one producer thread pushing, one thread dispatching / processing
+  template< typename event_t >
+  using async_spsc_stream = basic_async_stream< event_t, access_policy::none, spsc_queue >;
+
+  template< typename event_t >
+  using async_spsc_observer = basic_async_observer< event_t, access_policy::none, spsc_queue >;
+
+  // any number of producer threads pushing, one thread dispatching / processing
+  template< typename event_t >
+  using async_mpsc_stream = basic_async_stream< event_t, access_policy::none, mpsc_queue >;
+
+  template< typename event_t >
+  using async_mpsc_observer = basic_async_observer< event_t, access_policy::none, mpsc_queue >;
+
+  // any number of producer threads pushing, one thread processing whole batches at once
+  template< typename event_t >
+  using async_double_buffered_stream = basic_async_stream< event_t, access_policy::none, double_buffered_queue >;
+
+  template< typename event_t >
+  using async_double_buffered_observer = basic_async_observer< event_t, access_policy::none, double_buffered_queue >;
 }
 }
\ No newline at end of file
@@ -18,7 +18,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <cassert>
 #include <mutex>
+#include <shared_mutex>
+#include <thread>
 
 namespace mvd
 {
@@ -26,13 +30,21 @@ namespace streams
 {
 namespace access_policy
 {
+  // Every policy provides
+  // - scoped_lock, taken for modifications, e.g. (un)subscribing
+  // - scoped_shared_lock, taken for read-only access, e.g. dispatching to the observers.
+  //   Only shared_locked actually allows concurrent readers, the other policies take
+  //   the same lock as scoped_lock
+
   class none
   {
   public:
     struct mutex_t {};
     struct lock_t { ~lock_t(){} };  // non-trivial dtor prevents unused variable warning
+    using shared_lock_t = lock_t;
 
     static lock_t scoped_lock( mutex_t& ) { return lock_t{}; }
+    static shared_lock_t scoped_shared_lock( mutex_t& ) { return lock_t{}; }
   };
 
 
@@ -46,7 +58,165 @@ namespace access_policy
     {
       return std::unique_lock< mutex_t >( m_ );
     }
+
+    static lock_t scoped_shared_lock( mutex_t& m_ ) { return scoped_lock( m_ ); }
+  };  
+
+
+  // observers are dispatched to from an immutable snapshot without taking a lock, 
+  // the mutex only serializes modifications (see observer_list)
+  class copy_on_write
+  {
+    public:
+      using mutex_t = std::mutex;
+      using lock_t = std::unique_lock< mutex_t >;
+      
+    static lock_t scoped_lock( mutex_t& m_ )
+    {
+      return std::unique_lock< mutex_t >( m_ );
+    }
+
+    static lock_t scoped_shared_lock( mutex_t& m_ ) { return scoped_lock( m_ ); }
   };  
+
+
+  // test-and-test-and-set lock for very short critical sections. Spins on a relaxed load
+  // (so waiting threads don't keep stealing the cache line from the owner) with an
+  // exponentially growing number of pause instructions, yielding once that gets too long.
+  // Padded to a cache line to keep it from false sharing with neighbouring data
+  class alignas( 64 ) spin_mutex
+  {
+  public:
+
+    spin_mutex() = default;
+    spin_mutex( const spin_mutex& ) = delete;
+    spin_mutex& operator= ( const spin_mutex& ) = delete;
+
+    void lock()
+    {
+      unsigned backoff = 1;
+      while( !try_lock() )
+      {
+        while( m_locked.load( std::memory_order_relaxed ) )
+        {
+          if( backoff <= max_backoff )
+          {
+            for( unsigned i = 0; i < backoff; ++i )
+              pause();
+            backoff *= 2;
+          }
+          else
+            std::this_thread::yield();
+        }
+      }
+    }
+
+    bool try_lock()
+    {
+      return !m_locked.load( std::memory_order_relaxed ) &&
+        !m_locked.exchange( true, std::memory_order_acquire );
+    }
+
+    void unlock() { m_locked.store( false, std::memory_order_release ); }
+
+  private:
+
+    static constexpr unsigned max_backoff = 64;
+
+    static void pause()
+    {
+#if defined( __x86_64__ ) || defined( __i386__ )
+      __builtin_ia32_pause();
+#elif defined( __aarch64__ )
+      asm volatile( "yield" );
+#endif
+    }
+
+    std::atomic< bool > m_locked{ false };
+  };
+
+
+  class spinning
+  {
+    public:
+      using mutex_t = spin_mutex;
+      using lock_t = std::unique_lock< mutex_t >;
+      
+    static lock_t scoped_lock( mutex_t& m_ )
+    {
+      return std::unique_lock< mutex_t >( m_ );
+    }
+
+    static lock_t scoped_shared_lock( mutex_t& m_ ) { return scoped_lock( m_ ); }
+  };
+
+
+  // reader/writer lock: any number of threads can dispatch concurrently, (un)subscribing
+  // takes the lock exclusively
+  class shared_locked
+  {
+    public:
+#if __cplusplus >= 201703L
+      using mutex_t = std::shared_mutex;
+#else
+      using mutex_t = std::shared_timed_mutex;
+#endif
+      using lock_t = std::unique_lock< mutex_t >;
+      using shared_lock_t = std::shared_lock< mutex_t >;
+      
+    static lock_t scoped_lock( mutex_t& m_ )
+    {
+      return std::unique_lock< mutex_t >( m_ );
+    }
+
+    static shared_lock_t scoped_shared_lock( mutex_t& m_ )
+    {
+      return std::shared_lock< mutex_t >( m_ );
+    }
+  };
+
+
+  // for streams that are only ever used from a single thread. Debug builds assert that
+  // all accesses come from the thread that accessed it first, with NDEBUG defined it is
+  // equivalent to none
+  class thread_confined
+  {
+  public:
+#ifdef NDEBUG
+    struct mutex_t {};
+    struct lock_t { ~lock_t(){} };  // non-trivial dtor prevents unused variable warning
+
+    static lock_t scoped_lock( mutex_t& ) { return lock_t{}; }
+#else
+    class mutex_t
+    {
+    public:
+
+      void check_owner()
+      {
+        auto self = std::this_thread::get_id();
+        auto owner = std::thread::id();
+        if( !m_owner.compare_exchange_strong( owner, self ) )
+          assert( owner == self && "thread_confined stream accessed from another thread" );
+      }
+
+    private:
+
+      std::atomic< std::thread::id > m_owner{ std::thread::id() };
+    };
+
+    struct lock_t { ~lock_t(){} };
+
+    static lock_t scoped_lock( mutex_t& m_ )
+    {
+      m_.check_owner();
+      return lock_t{};
+    }
+#endif
+    using shared_lock_t = lock_t;
+
+    static shared_lock_t scoped_shared_lock( mutex_t& m_ ) { return scoped_lock( m_ ); }
+  };
 }
 }
 }
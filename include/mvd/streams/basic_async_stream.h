@@ -19,8 +19,15 @@
 #pragma once
 
 #include "basic_stream.h"
+#include "executor.h"
+#include "overflow_policy.h"
 
-#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
 
 namespace mvd
 {
@@ -30,72 +37,230 @@ namespace streams
   // default_queue
   // -----------------------------------------------------------------------------
 
+  // Bounded FIFO queue on a contiguous ring buffer. The buffer is allocated once, rounded
+  // up to a power of two so indices can be masked instead of wrapped; slots are left
+  // uninitialized until an event is pushed, so events needn't be default constructible.
+  // push fails once capacity_ events are queued. Not thread-safe.
   template< typename event_t >
   class default_queue
   {
+    using slot_t = typename std::aligned_storage< sizeof( event_t ), alignof( event_t ) >::type;
+
   public:
     default_queue( size_t capacity_  )
-      : m_events( capacity_ )
+      : m_capacity( capacity_ )
+      , m_mask( round_up_to_power_of_two( capacity_ ) - 1 )
+      , m_slots( new slot_t[ m_mask + 1 ] )
     {}
+
+    ~default_queue() { clear(); }
       
     default_queue( const default_queue& other_ ) { *this = other_; }
     default_queue& operator= ( const default_queue& other_ )
     {
-      m_size = other_.m_size;
-      m_events = other_.m_events;
+      if( this == &other_ )
+        return *this;
+
+      clear();
+      if( !m_slots || m_mask != other_.m_mask )
+      {
+        m_slots.reset( new slot_t[ other_.m_mask + 1 ] );
+        m_mask = other_.m_mask;
+      }
+      m_capacity = other_.m_capacity;
+
+      for( auto i = other_.m_head; i != other_.m_tail; ++i )
+        new ( &at( i ) ) event_t( other_.at( i ) );
+      m_head = other_.m_head;
+      m_tail = other_.m_tail;
       return *this;
     }
     
     default_queue( default_queue&& other_ ) { *this = std::move( other_ ); }
     default_queue& operator= ( default_queue&& other_ )
     {
-      m_size = other_.m_size;
-      other_.m_size = 0;
-      
-      m_events = std::move( other_.m_events );
+      if( this == &other_ )
+        return *this;
+
+      clear();
+      m_capacity = other_.m_capacity;
+      m_mask = other_.m_mask;
+      m_slots = std::move( other_.m_slots );
+      m_head = other_.m_head;
+      m_tail = other_.m_tail;
+
+      other_.m_capacity = 0;
+      other_.m_head = other_.m_tail = 0;
       return *this;
     }
     
     
     bool push( const event_t& e_ )
     {
-      if( m_size >= m_events.size() )
+      if( size() >= m_capacity )
         return false;
         
-      m_events[m_size++] = e_;
+      new ( &at( m_tail ) ) event_t( e_ );
+      ++m_tail;
       return true;
     }
     
     bool push( event_t&& e_ )
     {
-      if( m_size >= m_events.size() )
+      if( size() >= m_capacity )
         return false;
       
-      m_events[m_size++] = std::move( e_ );
-      
+      new ( &at( m_tail ) ) event_t( std::move( e_ ) );
+      ++m_tail;
       return true;
     }
     
     bool pop( event_t& e_ )
     {
-      if( m_size == 0 )
+      return consume_one( [&e_]( event_t& front_ ) { e_ = std::move( front_ ); } );
+    }
+
+    // invokes fn_ with the oldest event in place, then removes it
+    template< typename fn_t >
+    bool consume_one( fn_t&& fn_ )
+    {
+      if( m_head == m_tail )
         return false;
-      
-      e_ = m_events[0];
-      m_events.pop_front();
-      m_events.emplace_back();
-      --m_size;
-      
+
+      auto& e = at( m_head );
+      fn_( e );
+      e.~event_t();
+      ++m_head;
+      return true;
+    }
+
+    size_t size() const { return m_tail - m_head; }
+    bool empty() const { return m_head == m_tail; }
+    size_t capacity() const { return m_capacity; }
+
+    // doubles the capacity, but not beyond maxCapacity_. Returns false if the capacity
+    // already is maxCapacity_
+    bool grow( size_t maxCapacity_ )
+    {
+      if( m_capacity >= maxCapacity_ )
+        return false;
+
+      auto capacity = std::min( std::max< size_t >( 2 * m_capacity, 1 ), maxCapacity_ );
+      auto slotCount = round_up_to_power_of_two( capacity );
+      if( slotCount > m_mask + 1 )
+      {
+        auto slots = std::unique_ptr< slot_t[] >( new slot_t[ slotCount ] );
+        size_t n = 0;
+        while( consume_one( [&slots, &n]( event_t& e_ ) { new ( &slots[ n++ ] ) event_t( std::move( e_ ) ); } ) ) {}
+
+        m_slots = std::move( slots );
+        m_mask = slotCount - 1;
+        m_head = 0;
+        m_tail = n;
+      }
+      m_capacity = capacity;
       return true;
     }
     
   private:
+
+    static size_t round_up_to_power_of_two( size_t n_ )
+    {
+      size_t p = 1;
+      while( p < n_ )
+        p <<= 1;
+      return p;
+    }
+
+    event_t& at( size_t index_ ) const { return *reinterpret_cast< event_t* >( &m_slots[ index_ & m_mask ] ); }
+
+    void clear()
+    {
+      while( consume_one( []( event_t& ) {} ) ) {}
+    }
+
   
-    std::deque< event_t > m_events;
-    size_t m_size{0};
+    size_t m_capacity = 0;
+    size_t m_mask = 0;
+    std::unique_ptr< slot_t[] > m_slots;
+    size_t m_head = 0;  // both indices increase monotonically and are masked on access
+    size_t m_tail = 0;
   };
+
+  template< typename event_t >
+  struct supports_exclusive_overflow< default_queue< event_t > > : std::true_type {};
   
   
+  // -----------------------------------------------------------------------------
+  // bounded draining
+  // -----------------------------------------------------------------------------
+
+  struct drain_result
+  {
+    size_t processed;
+    size_t remaining;  // a snapshot; only 0 or 1 (= some / maybe some) for queues without size()
+  };
+
+
+  namespace detail
+  {
+    // queues with neither size() nor empty() report unknown_, which the drain sets to 1 unless
+    // consume_one() found the queue empty, so run() keeps rescheduling until then
+    template< typename queue_t >
+    auto queue_size( const queue_t& q_, size_t, int ) -> decltype( size_t( q_.size() ) )
+    {
+      return q_.size();
+    }
+
+    template< typename queue_t >
+    auto queue_size( const queue_t& q_, size_t, long ) -> decltype( size_t( q_.empty() ? 0 : 1 ) )
+    {
+      return q_.empty() ? 0 : 1;
+    }
+
+    template< typename queue_t >
+    size_t queue_size( const queue_t&, size_t unknown_, ... ) { return unknown_; }
+
+    // consumes up to maxEvents_ events, stops early once the deadline has passed. The clock is
+    // read before every event, so the deadline is overrun by at most one event
+    template< typename queue_t, typename fn_t, typename deadline_t >
+    drain_result drain( queue_t& q_, fn_t&& fn_, size_t maxEvents_, const deadline_t& deadline_ )
+    {
+      size_t processed = 0;
+      bool ranEmpty = false;
+      while( processed < maxEvents_ && deadline_t::clock::now() < deadline_ )
+      {
+        if( !q_.consume_one( fn_ ) )
+        {
+          ranEmpty = true;
+          break;
+        }
+        ++processed;
+      }
+
+      return drain_result{ processed, queue_size( q_, ranEmpty ? 0 : 1, 0 ) };
+    }
+
+    template< typename queue_t, typename fn_t >
+    drain_result drain( queue_t& q_, fn_t&& fn_, size_t maxEvents_ )
+    {
+      size_t processed = 0;
+      bool ranEmpty = false;
+      while( processed < maxEvents_ )
+      {
+        if( !q_.consume_one( fn_ ) )
+        {
+          ranEmpty = true;
+          break;
+        }
+        ++processed;
+      }
+
+      return drain_result{ processed, queue_size( q_, ranEmpty ? 0 : 1, 0 ) };
+    }
+  }
+
+
   // -----------------------------------------------------------------------------
   // basic_async_stream
   // -----------------------------------------------------------------------------
@@ -105,13 +270,15 @@ namespace streams
     typename access_policy_t,
     template< typename > class collection_t = default_queue
   >
-  class basic_async_stream : public basic_stream< event_t, access_policy_t >
+  class basic_async_stream 
+    : public basic_stream< event_t, access_policy_t >
+    , public runnable
   {
     using base_t = basic_stream< event_t, access_policy_t >;
 
   public:
   
-    using on_event_hook_t = std::function< bool( event_t ) >;
+    using on_event_hook_t = copyable_inline_function< bool( const event_t& ) >;
 
     basic_async_stream( collection_t< event_t >&& preparedQueue_ )
       : m_events( std::move( preparedQueue_ ) )
@@ -133,42 +300,181 @@ namespace streams
       : base_t( std::move( s_ ) )
       , m_events( queueSize_ )
     {}
+
+    ~basic_async_stream() override { set_executor( nullptr ); }
+
+    // a copy is attached to the same executor
+    basic_async_stream( const basic_async_stream& other_ )
+      : base_t( static_cast< const base_t& >( other_ ) )
+      , runnable()
+      , m_events( other_.m_events )
+      , m_onEventHook( other_.m_onEventHook )
+      , m_overflowPolicy( other_.m_overflowPolicy )
+      , m_overflowStatistics( other_.m_overflowStatistics )
+    {
+      set_executor( other_.m_executor );
+    }
+
+    basic_async_stream& operator= ( const basic_async_stream& other_ )
+    {
+      if( this == &other_ )
+        return *this;
+
+      set_executor( nullptr );
+      base_t::operator= ( other_ );
+      m_events = other_.m_events;
+      m_onEventHook = other_.m_onEventHook;
+      m_overflowPolicy = other_.m_overflowPolicy;
+      m_overflowStatistics = other_.m_overflowStatistics;
+      set_executor( other_.m_executor );
+      return *this;
+    }
+
+    // the moved-from stream is detached from its executor, the new one takes its place
+    basic_async_stream( basic_async_stream&& other_ )
+      : base_t( static_cast< base_t&& >( other_.detach_executor() ) )
+      , runnable()
+      , m_events( std::move( other_.m_events ) )
+      , m_onEventHook( std::move( other_.m_onEventHook ) )
+      , m_overflowPolicy( std::move( other_.m_overflowPolicy ) )
+      , m_overflowStatistics( other_.m_overflowStatistics )
+    {
+      set_executor( other_.m_executor );
+      other_.m_executor = nullptr;
+    }
+
+    basic_async_stream& operator= ( basic_async_stream&& other_ )
+    {
+      if( this == &other_ )
+        return *this;
+
+      set_executor( nullptr );
+      other_.detach_executor();
+      base_t::operator= ( std::move( other_ ) );
+      m_events = std::move( other_.m_events );
+      m_onEventHook = std::move( other_.m_onEventHook );
+      m_overflowPolicy = std::move( other_.m_overflowPolicy );
+      m_overflowStatistics = other_.m_overflowStatistics;
+      set_executor( other_.m_executor );
+      other_.m_executor = nullptr;
+      return *this;
+    }
     
+    // the event is moved into the queue, and moved out of it again on dispatch, so an
+    // rvalue pushed into the stream reaches the last observer without being copied
     basic_async_stream& operator << ( event_t e_ ) final
     {
       if( !m_onEventHook || m_onEventHook( e_ ) )
       {
-        m_events.push( event_t( e_ ) );
+        m_overflowPolicy.push( m_events, std::move( e_ ), m_overflowStatistics );
+        if( m_executor )
+          m_executor->schedule( *this );
       }
       return *this;
     }
-    
-    void dispatch_events()
+
+    basic_async_stream& push_events( span< event_t > events_ ) final
     {
-      event_t e;
-      while( m_events.pop( e ) )
+      for( auto& e : events_ )
       {
-        this->for_each_observer(
-          [&e]( observer_base< access_policy_t >& o_ )
-          {
-            static_cast< typename base_t::observer_t& >( o_ ).on_event( e );
-          }
-        );
+        if( !m_onEventHook || m_onEventHook( e ) )
+          m_overflowPolicy.push( m_events, static_cast< const event_t& >( e ), m_overflowStatistics );
       }
+      if( m_executor )
+        m_executor->schedule( *this );
+      return *this;
     }
     
-    // can use this for pre-filtering events or for automatically triggering processing 
-    // on another thread, e.g. by using a condition_variable on the logging thread that
-    // - when notified - calls dispatch_events
+    // events are dispatched straight out of the queue via consume_one, which the collection
+    // has to provide (boost::lockfree queues do)
+    void dispatch_events()
+    {
+      while( m_events.consume_one( [this]( event_t& e_ ) { this->dispatch( e_ ); } ) ) {}
+    }
+
+    // dispatches at most maxEvents_ events, e.g. to multiplex many streams on one thread
+    drain_result dispatch_events( size_t maxEvents_ )
+    {
+      return detail::drain( m_events, [this]( event_t& e_ ) { this->dispatch( e_ ); }, maxEvents_ );
+    }
+
+    // dispatches events until the deadline has passed or maxEvents_ have been dispatched
+    template< typename clock_t, typename duration_t >
+    drain_result dispatch_events(
+      const std::chrono::time_point< clock_t, duration_t >& deadline_,
+      size_t maxEvents_ = std::numeric_limits< size_t >::max()
+    )
+    {
+      return detail::drain( m_events, [this]( event_t& e_ ) { this->dispatch( e_ ); }, maxEvents_, deadline_ );
+    }
+
+    // for queues providing consume_batch (e.g. double_buffered_queue): dispatches all queued
+    // events as one batch, i.e. observers are notified via on_events. Returns their number
+    size_t dispatch_event_batch()
+    {
+      return m_events.consume_batch( [this]( span< event_t > events_ ) { base_t::push_events( events_ ); } );
+    }
+
+    // called by the executor. Dispatches in batches and reschedules itself if events
+    // remain, so a busy stream doesn't starve others on the same executor
+    void run() override
+    {
+      if( dispatch_events( run_batch_size ).remaining && m_executor )
+        m_executor->schedule( *this );
+    }
+
+    // dispatches the events on the given executor (e.g. a dispatcher) as soon as they are
+    // pushed, instead of waiting for dispatch_events to be called. The queue has to be safe
+    // to push to and consume from concurrently (e.g. spsc_queue or mpsc_queue). nullptr
+    // detaches the stream again
+    void set_executor( executor* executor_ )
+    {
+      detach_executor();
+      m_executor = executor_;
+      if( m_executor )
+        m_executor->attach( *this );
+    }
+    
+    // can use this for pre-filtering events or for triggering processing by other means
+    // than an executor (see set_executor)
     void register_on_event_hook( on_event_hook_t hook_ )
     {
       m_onEventHook = std::move( hook_ );
     }
+
+    // what to do with events that don't fit into the queue, drop_newest by default.
+    // Must not be changed while events are being pushed
+    void set_overflow_policy( overflow_policy< event_t > policy_ )
+    {
+      m_overflowPolicy = std::move( policy_ );
+    }
+
+    void set_overflow_policy( const exclusive_overflow_policy< event_t >& policy_ )
+    {
+      static_assert( supports_exclusive_overflow< collection_t< event_t > >::value,
+        "drop_oldest and grow access the queue on the pushing thread, which this queue doesn't support" );
+      m_overflowPolicy = policy_.policy();
+    }
+
+    const overflow_statistics& get_overflow_statistics() const { return m_overflowStatistics; }
     
   private:
   
     collection_t< event_t > m_events;
     on_event_hook_t m_onEventHook;
+    overflow_policy< event_t > m_overflowPolicy = overflow_policy< event_t >::drop_newest();
+    overflow_statistics m_overflowStatistics;
+    executor* m_executor = nullptr;
+
+    static constexpr size_t run_batch_size = 256;
+
+    // keeps m_executor, so a moved-to stream can take its place
+    basic_async_stream& detach_executor()
+    {
+      if( m_executor )
+        m_executor->detach( *this );
+      return *this;
+    }
   };
 
 
@@ -196,23 +502,73 @@ namespace streams
       : m_events( queueSize_ )
     {}
       
+    // copies the event into the queue, unless this is the last observer notified (see take_event).
+    // For large events observed by many async observers, see shared_event. Events that don't
+    // fit are handled by the overflow policy, as for basic_async_stream
     void on_event( event_t& e_ ) override
     {
-      m_events.push( event_t( e_ ) );
+      m_overflowPolicy.push( m_events, static_cast< const event_t& >( e_ ), m_overflowStatistics );
+    }
+
+    void take_event( event_t&& e_ ) override
+    {
+      m_overflowPolicy.push( m_events, std::move( e_ ), m_overflowStatistics );
     }
+
+    // see basic_async_stream::set_overflow_policy
+    void set_overflow_policy( overflow_policy< event_t > policy_ )
+    {
+      m_overflowPolicy = std::move( policy_ );
+    }
+
+    void set_overflow_policy( const exclusive_overflow_policy< event_t >& policy_ )
+    {
+      static_assert( supports_exclusive_overflow< collection_t< event_t > >::value,
+        "drop_oldest and grow access the queue on the pushing thread, which this queue doesn't support" );
+      m_overflowPolicy = policy_.policy();
+    }
+
+    const overflow_statistics& get_overflow_statistics() const { return m_overflowStatistics; }
     
     void on_done() override {}
     
-    void process_events( const std::function< void( const event_t& ) >& f_ )
+    template< typename fn_t >
+    void process_events( fn_t&& f_ )
+    {
+      while( m_events.consume_one( [&f_]( event_t& e_ ) { f_( e_ ); } ) ) {}
+    }
+
+    // processes at most maxEvents_ events
+    template< typename fn_t >
+    drain_result process_events( fn_t&& f_, size_t maxEvents_ )
+    {
+      return detail::drain( m_events, [&f_]( event_t& e_ ) { f_( e_ ); }, maxEvents_ );
+    }
+
+    // processes events until the deadline has passed or maxEvents_ have been processed
+    template< typename fn_t, typename clock_t, typename duration_t >
+    drain_result process_events(
+      fn_t&& f_,
+      const std::chrono::time_point< clock_t, duration_t >& deadline_,
+      size_t maxEvents_ = std::numeric_limits< size_t >::max()
+    )
+    {
+      return detail::drain( m_events, [&f_]( event_t& e_ ) { f_( e_ ); }, maxEvents_, deadline_ );
+    }
+
+    // for queues providing consume_batch (e.g. double_buffered_queue): hands all queued events
+    // to f_ as span< event_t > rather than one by one. Returns their number
+    template< typename fn_t >
+    size_t process_event_batch( fn_t&& f_ )
     {
-      event_t e;
-      while( m_events.pop( e ) )
-        f_( e );
+      return m_events.consume_batch( std::forward< fn_t >( f_ ) );
     }
     
   private:
   
     collection_t< event_t > m_events;
+    overflow_policy< event_t > m_overflowPolicy = overflow_policy< event_t >::drop_newest();
+    overflow_statistics m_overflowStatistics;
   };
   
   
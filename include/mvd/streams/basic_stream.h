@@ -18,8 +18,13 @@
 
 #pragma once
 
+#include "inline_function.h"
 #include "observer.h"
+#include "slab.h"
+#include "span.h"
 
+#include <cstddef>
+#include <functional>
 #include <memory>
 
 
@@ -44,7 +49,9 @@ namespace streams
     using access_policy = access_policy_t;
 
     using observer_t = basic_observer< event_t, access_policy_t >;
-    using on_event_t = std::function< void( event_t& ) >;
+    using on_event_t = inline_function< void( event_t& ) >;
+
+    class lambda_subscription;
     
 
     basic_stream() = default;
@@ -61,6 +68,9 @@ namespace streams
     basic_stream& operator= ( const basic_stream& other_ )
     {
       base_t::operator= ( other_ );
+      m_parallelPool = other_.m_parallelPool;
+      m_parallelFor = other_.m_parallelFor;
+      m_minParallelObservers = other_.m_minParallelObservers;
       if( other_.m_source )
       {
         m_source = other_.m_source->clone();
@@ -75,6 +85,9 @@ namespace streams
       //should moving the basic_stream actually move the observers??
       base_t::operator= ( std::move( other_ ) );
       m_lambdaObservers = std::move( other_.m_lambdaObservers );
+      m_parallelPool = other_.m_parallelPool;
+      m_parallelFor = other_.m_parallelFor;
+      m_minParallelObservers = other_.m_minParallelObservers;
       m_source = std::move( other_.m_source );
       if( m_source )
         m_source->attach( *this );
@@ -82,20 +95,111 @@ namespace streams
     }
     
     void subscribe( observer_t& o_ ) { base_t::register_observer( o_ ); }
-    void subscribe( on_event_t callback_ );
     void unsubscribe( observer_t& o_ ) { base_t::unregister_observer( o_ ); }
 
+    // unsubscribes o_ when the returned handle is destroyed
+    scoped_subscription< access_policy_t > subscribe_scoped( observer_t& o_ )
+    {
+      return scoped_subscription< access_policy_t >( *this, o_ );
+    }
+
+    // lambda subscriptions live in slab storage owned by the stream, subscribing never moves
+    // existing ones and slots are reused after unsubscribing. Unsubscribing a handle again,
+    // or a copy of it, has no effect - even once its slot holds a new subscription
+    lambda_subscription subscribe( on_event_t callback_ );
+    void unsubscribe( lambda_subscription s_ );
+
+    // Events are passed on with as few copies as possible:
+    // - the event is taken by value, so pushing an lvalue copies it once, pushing an rvalue
+    //   moves it
+    // - all observers but the last one receive it by reference via on_event, the last one
+    //   is handed over the event via take_event and may move from it
+    // i.e. pushing an rvalue into a stream does not copy the event at all
     virtual basic_stream& operator << ( event_t e_ );
+
+    // pushes a contiguous batch of events. Observers are notified via on_events, i.e. the
+    // observer list is locked and walked once per batch instead of once per event. Observers
+    // receive references into the given range
+    virtual basic_stream& push_events( span< event_t > events_ );
     void on_done();
 
+    // Opt-in: once at least minObservers_ observers are subscribed, each event (or batch) is
+    // dispatched to them concurrently on pool_, and pushing it returns once all of them have
+    // been notified. So every observer still sees the events in order and one at a time, but
+    // different observers see the same event at once - they must only read it, and none of
+    // them takes over the event via take_event. The observer list isn't locked meanwhile,
+    // unsubscribing waits for the dispatches still notifying the observer though.
+    // pool_ is a fork_join_pool or any other pool providing parallel_for( count, fn ), which
+    // is why the pool type is only needed where this is called. nullptr switches back to
+    // sequential dispatch. Must not be changed while events are being pushed
+    template< typename pool_t >
+    void set_parallel_dispatch( pool_t* pool_, size_t minObservers_ = 2 )
+    {
+      m_parallelPool = pool_;
+      m_parallelFor = pool_ ? &run_parallel_for< pool_t > : nullptr;
+      m_minParallelObservers = minObservers_;
+    }
+
+    void set_parallel_dispatch( std::nullptr_t )
+    {
+      m_parallelPool = nullptr;
+      m_parallelFor = nullptr;
+    }
+
+  protected:
+
+    // notifies all observers of e_, which is owned by the caller and may be moved from
+    void dispatch( event_t& e_ );
+
   private:
 
+    bool dispatch_in_parallel() const
+    {
+      return m_parallelPool && this->get_observer_count() >= m_minParallelObservers;
+    }
+
+    // type-erased pool_t::parallel_for, calls fn_( context_, i ) for every i < count_
+    using parallel_for_fn_t = void (*)( void* pool_, size_t count_, void (*fn_)( void*, size_t ), void* context_ );
+
+    template< typename pool_t >
+    static void run_parallel_for( void* pool_, size_t count_, void (*fn_)( void*, size_t ), void* context_ )
+    {
+      static_cast< pool_t* >( pool_ )->parallel_for( count_, [fn_, context_]( size_t i_ ) { fn_( context_, i_ ); } );
+    }
+
+    template< typename fn_t >
+    void for_each_observer_parallel( fn_t& fn_ )
+    {
+      using observer_base_t = observer_base< access_policy_t >;
+
+      this->with_observer_snapshot(
+        [this, &fn_]( observer_base_t* const* observers_, size_t count_ )
+        {
+          struct context_t
+          {
+            observer_base_t* const* observers;
+            fn_t* fn;
+          } context{ observers_, &fn_ };
+
+          m_parallelFor( m_parallelPool, count_,
+            []( void* context_, size_t i_ )
+            {
+              auto& c = *static_cast< context_t* >( context_ );
+              ( *c.fn )( *c.observers[ i_ ] );
+            },
+            &context
+          );
+        }
+      );
+    }
+
+
     class lambda_observer : public observer_t
     {
     public:
 
       lambda_observer( on_event_t callback_ )
-        : m_onEvent( callback_ )
+        : m_onEvent( std::move( callback_ ) )
       {}
 
       void on_event( event_t& e_ ) final { m_onEvent( e_ ); }
@@ -138,9 +242,13 @@ namespace streams
       source_impl_t m_impl;
     };
     
-    std::vector< lambda_observer > m_lambdaObservers;
+    slab< lambda_observer > m_lambdaObservers;
     typename access_policy_t::mutex_t m_mutex;
     source_ptr_t m_source;
+
+    void* m_parallelPool = nullptr;
+    parallel_for_fn_t m_parallelFor = nullptr;
+    size_t m_minParallelObservers = 2;
   };
 
 
@@ -156,6 +264,17 @@ namespace streams
 
     virtual void on_event( event_t& e_ ) = 0;
     virtual void on_done() = 0;
+
+    // called instead of on_event if this is the last observer to be notified of an event that
+    // is owned by the stream - override this to move from the event instead of copying it
+    virtual void take_event( event_t&& e_ ) { on_event( e_ ); }
+
+    // override this to handle batches pushed via push_events in one go
+    virtual void on_events( span< event_t > events_ )
+    {
+      for( auto& e : events_ )
+        on_event( e );
+    }
   };
 
   
@@ -167,11 +286,51 @@ namespace streams
   // -----------------------------------------------------------------------------
 
   template< typename event_t, typename access_policy_t >
-  inline void basic_stream< event_t, access_policy_t >::subscribe( on_event_t callback_ )
+  class basic_stream< event_t, access_policy_t >::lambda_subscription
+  {
+    friend class basic_stream< event_t, access_policy_t >;
+  public:
+
+    lambda_subscription() = default;
+
+    explicit operator bool() const { return m_observer != nullptr; }
+
+  private:
+
+    lambda_subscription( lambda_observer& o_, size_t generation_ )
+      : m_observer( &o_ )
+      , m_generation( generation_ )
+    {}
+
+    lambda_observer* m_observer = nullptr;
+    size_t m_generation = 0;  // tells a stale handle from a new subscription in the same slot
+  };
+
+
+  template< typename event_t, typename access_policy_t >
+  inline typename basic_stream< event_t, access_policy_t >::lambda_subscription
+  basic_stream< event_t, access_policy_t >::subscribe( on_event_t callback_ )
   {
     auto l = access_policy_t::scoped_lock( m_mutex );
-    m_lambdaObservers.emplace_back( callback_ );
-    subscribe( m_lambdaObservers.back() );
+    auto& o = m_lambdaObservers.emplace( std::move( callback_ ) );
+    subscribe( o );
+    return lambda_subscription( o, m_lambdaObservers.generation( o ) );
+  }
+
+
+  template< typename event_t, typename access_policy_t >
+  inline void basic_stream< event_t, access_policy_t >::unsubscribe( lambda_subscription s_ )
+  {
+    if( !s_ )
+      return;
+
+    // handles are copyable, so s_ may already have been unsubscribed
+    auto l = access_policy_t::scoped_lock( m_mutex );
+    if( !m_lambdaObservers.contains( *s_.m_observer, s_.m_generation ) )
+      return;
+
+    unsubscribe( *s_.m_observer );
+    m_lambdaObservers.erase( *s_.m_observer );
   }
 
 
@@ -180,15 +339,57 @@ namespace streams
     event_t e_
   )
   {
+    dispatch( e_ );
+    return *this;
+  }
+
+
+  template< typename event_t, typename access_policy_t >
+  inline void basic_stream< event_t, access_policy_t >::dispatch( event_t& e_ )
+  {
+    if( dispatch_in_parallel() )
+    {
+      auto notify = [&e_]( observer_base< access_policy_t >& o_ )
+      {
+        static_cast< observer_t& >( o_ ).on_event( e_ );
+      };
+      for_each_observer_parallel( notify );
+      return;
+    }
+
     this->for_each_observer(
       [&e_]( observer_base< access_policy_t >& o_ )
       {
         static_cast< observer_t& >( o_ ).on_event( e_ );
+      },
+      [&e_]( observer_base< access_policy_t >& o_ )
+      {
+        static_cast< observer_t& >( o_ ).take_event( std::move( e_ ) );
       }
     );
-    return *this;
   }
   
+  template< typename event_t, typename access_policy_t >
+  inline basic_stream< event_t, access_policy_t >& basic_stream< event_t, access_policy_t >::push_events(
+    span< event_t > events_
+  )
+  {
+    if( events_.empty() )
+      return *this;
+
+    auto notify = [&events_]( observer_base< access_policy_t >& o_ )
+    {
+      static_cast< observer_t& >( o_ ).on_events( events_ );
+    };
+
+    if( dispatch_in_parallel() )
+      for_each_observer_parallel( notify );
+    else
+      this->for_each_observer( notify );
+    return *this;
+  }
+
+
   template< typename event_t, typename access_policy_t >
   inline void basic_stream< event_t, access_policy_t >::on_done()
   {
@@ -0,0 +1,225 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+// requires C++20, which is why this header is not included by mvd/streams.h
+// (see the STREAMS_WITH_COROUTINES option in CMakeLists.txt)
+#if __cplusplus < 202002L && !( defined( _MSVC_LANG ) && _MSVC_LANG >= 202002L )
+#error "mvd/streams/coroutine.h requires C++20"
+#endif
+
+#include "basic_async_stream.h"
+#include "executor.h"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // coroutine_observer
+  // -----------------------------------------------------------------------------
+
+  // basic_async_observer that a coroutine consumes by awaiting next():
+  //
+  //   while( auto e = co_await observer.next() )
+  //     handle( *e );
+  //
+  // Events are queued in collection_t under the observer's overflow policy, next() takes
+  // them from there and yields std::nullopt once on_done has been received and the queue
+  // is empty. A consumer suspended in next() is resumed as soon as an event arrives, so no
+  // thread has to poll:
+  // - without an executor it is resumed inline, on the pushing thread and while the source
+  //   stream still holds its observer list lock. The consumer must then not push to,
+  //   subscribe to or unsubscribe from that stream, it would deadlock
+  // - with an executor (see set_executor) it is resumed on the executor once the push has
+  //   returned, which lifts that restriction
+  // Whenever producer and consumer run on different threads, access_policy_t must be
+  // thread-safe and collection_t a queue for concurrent producers and a consumer, e.g.
+  // spsc_queue. Only one coroutine may await next() at a time, and it must not still be
+  // waiting when the observer is destroyed - it would never be resumed.
+  template<
+    typename event_t,
+    typename access_policy_t,
+    template< typename > class collection_t = default_queue
+  >
+  class coroutine_observer
+    : public basic_async_observer< event_t, access_policy_t, collection_t >
+    , public runnable
+  {
+    using base_t = basic_async_observer< event_t, access_policy_t, collection_t >;
+
+  public:
+
+    class awaiter
+    {
+    public:
+
+      explicit awaiter( coroutine_observer& o_ ) : m_observer( o_ ) {}
+
+      bool await_ready() const noexcept { return false; }
+
+      // doesn't suspend if an event is queued already or the stream is done
+      bool await_suspend( std::coroutine_handle<> h_ )
+      {
+        auto l = access_policy_t::scoped_lock( m_observer.m_mutex );
+        if( m_observer.take( m_result ) || m_observer.m_done )
+          return false;
+
+        m_observer.m_waiter = h_;
+        m_observer.m_slot = &m_result;
+        return true;
+      }
+
+      std::optional< event_t > await_resume() { return std::move( m_result ); }
+
+    private:
+
+      coroutine_observer& m_observer;
+      std::optional< event_t > m_result;
+    };
+
+
+    coroutine_observer( collection_t< event_t >&& preparedQueue_ )
+      : base_t( std::move( preparedQueue_ ) )
+    {}
+
+    coroutine_observer( size_t queueSize_ )
+      : base_t( queueSize_ )
+    {}
+
+    ~coroutine_observer() override { set_executor( nullptr ); }
+
+    // bound to the coroutine awaiting it
+    coroutine_observer( const coroutine_observer& ) = delete;
+    coroutine_observer& operator= ( const coroutine_observer& ) = delete;
+
+    awaiter next() { return awaiter( *this ); }
+
+    void on_event( event_t& e_ ) override
+    {
+      base_t::on_event( e_ );
+      wake();
+    }
+
+    void take_event( event_t&& e_ ) override
+    {
+      base_t::take_event( std::move( e_ ) );
+      wake();
+    }
+
+    void on_done() override
+    {
+      {
+        auto l = access_policy_t::scoped_lock( m_mutex );
+        m_done = true;
+      }
+      wake();
+    }
+
+    // resumes the consumer on executor_ instead of inline in the push. Must be set before
+    // events arrive
+    void set_executor( executor* executor_ )
+    {
+      if( m_executor )
+        m_executor->detach( *this );
+      m_executor = executor_;
+      if( m_executor )
+        m_executor->attach( *this );
+    }
+
+    // called by the executor
+    void run() override
+    {
+      std::coroutine_handle<> ready;
+      {
+        auto l = access_policy_t::scoped_lock( m_mutex );
+        ready = std::exchange( m_ready, nullptr );
+      }
+      if( ready )
+        ready.resume();
+    }
+
+  private:
+
+    // the queue is only ever consumed under m_mutex, so a waiting consumer can't miss an
+    // event that was pushed before it registered
+    bool take( std::optional< event_t >& slot_ )
+    {
+      return this->process_events( [&slot_]( event_t& e_ ) { slot_.emplace( std::move( e_ ) ); }, 1 ).processed == 1;
+    }
+
+    void wake()
+    {
+      std::coroutine_handle<> waiter;
+      {
+        auto l = access_policy_t::scoped_lock( m_mutex );
+        if( !m_waiter )
+          return;
+
+        // nothing to hand over if the overflow policy dropped the event
+        if( !take( *m_slot ) && !m_done )
+          return;
+
+        waiter = std::exchange( m_waiter, nullptr );
+        if( m_executor )
+          m_ready = std::exchange( waiter, nullptr );
+      }
+
+      if( waiter )
+        waiter.resume();
+      else
+        m_executor->schedule( *this );
+    }
+
+
+    std::coroutine_handle<> m_waiter;
+    std::coroutine_handle<> m_ready;  // handed over to the executor
+    std::optional< event_t >* m_slot = nullptr;
+    bool m_done = false;
+    executor* m_executor = nullptr;
+    typename access_policy_t::mutex_t m_mutex;
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // detached_task
+  // -----------------------------------------------------------------------------
+
+  // minimal return type for fire-and-forget consumer coroutines: starts running immediately
+  // and frees its frame when it finishes. Exceptions escaping the coroutine terminate
+  struct detached_task
+  {
+    struct promise_type
+    {
+      detached_task get_return_object() noexcept { return {}; }
+      std::suspend_never initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+      void return_void() noexcept {}
+      void unhandled_exception() noexcept { std::terminate(); }
+    };
+  };
+
+}
+}
@@ -0,0 +1,179 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // dispatcher
+  // -----------------------------------------------------------------------------
+
+  // Executor owning one thread that runs the attached runnables that have been scheduled,
+  // e.g. drains the queues of async streams.
+  //
+  // schedule() marks the runnable in its schedule_state and raises a pending flag, a round
+  // then runs only the marked runnables - idle ones cost a load, not a run(). A runnable
+  // that is already marked returns right away.
+  // The thread parks on a condition variable once a round found no new work and spinCount_
+  // further checks haven't turned up any either. schedule() only takes the mutex to notify
+  // the thread if it is parked - as long as the dispatcher keeps up, pushing into a stream
+  // never makes a syscall.
+  // Runnables must not be attached to / detached from within run().
+  class dispatcher : public executor
+  {
+  public:
+
+    explicit dispatcher( size_t spinCount_ = 64 )
+      : m_spinCount( spinCount_ )
+      , m_thread( [this]() { loop(); } )
+    {}
+
+    ~dispatcher() override { stop(); }
+
+    dispatcher( const dispatcher& ) = delete;
+    dispatcher& operator= ( const dispatcher& ) = delete;
+
+    void attach( runnable& r_ ) override
+    {
+      {
+        std::lock_guard< std::mutex > l( m_runnablesMutex );
+        r_.schedule_state().store( 0 );
+        m_runnables.push_back( &r_ );
+      }
+      schedule( r_ );  // it may already have work
+    }
+
+    void detach( runnable& r_ ) override
+    {
+      std::lock_guard< std::mutex > l( m_runnablesMutex );
+      m_runnables.erase( std::remove( m_runnables.begin(), m_runnables.end(), &r_ ), m_runnables.end() );
+    }
+
+    void schedule( runnable& r_ ) override
+    {
+      // already marked, the loop will run it
+      if( r_.schedule_state().exchange( 1 ) != 0 )
+        return;
+
+      m_pending.store( true );
+      if( m_parked.load() )
+      {
+        std::lock_guard< std::mutex > l( m_parkMutex );
+        m_wakeup.notify_one();
+      }
+    }
+
+    // runs the pending work one last time and joins the thread
+    void stop()
+    {
+      if( !m_thread.joinable() )
+        return;
+
+      {
+        std::lock_guard< std::mutex > l( m_parkMutex );
+        m_stopped.store( true );
+        m_wakeup.notify_one();
+      }
+      m_thread.join();
+    }
+
+  private:
+
+    void loop()
+    {
+      while( !m_stopped.load() )
+      {
+        if( m_pending.exchange( false ) )
+        {
+          run_scheduled();
+          continue;
+        }
+
+        if( spin() )
+          continue;
+
+        park();
+      }
+
+      run_scheduled();
+    }
+
+    // the mark is cleared before run(), so scheduling it again while it runs isn't lost
+    void run_scheduled()
+    {
+      std::lock_guard< std::mutex > l( m_runnablesMutex );
+      for( auto r : m_runnables )
+      {
+        if( r->schedule_state().load() != 0 && r->schedule_state().exchange( 0 ) != 0 )
+          r->run();
+      }
+    }
+
+    bool spin()
+    {
+      for( size_t i = 0; i < m_spinCount; ++i )
+      {
+        if( m_pending.load( std::memory_order_relaxed ) || m_stopped.load( std::memory_order_relaxed ) )
+          return true;
+        std::this_thread::yield();
+      }
+      return false;
+    }
+
+    void park()
+    {
+      std::unique_lock< std::mutex > l( m_parkMutex );
+
+      // announce parking before the final check, schedule() sets pending before it checks
+      // m_parked, so (both being sequentially consistent) one of them sees the other
+      m_parked.store( true );
+      m_wakeup.wait( l, [this]() { return m_pending.load() || m_stopped.load(); } );
+      m_parked.store( false );
+    }
+
+
+    const size_t m_spinCount;
+
+    std::atomic< bool > m_pending{ false };
+    std::atomic< bool > m_parked{ false };
+    std::atomic< bool > m_stopped{ false };
+
+    std::mutex m_parkMutex;
+    std::condition_variable m_wakeup;
+
+    std::mutex m_runnablesMutex;
+    std::vector< runnable* > m_runnables;
+
+    std::thread m_thread;  // last, so everything else is initialized when the thread starts
+  };
+
+}
+}
@@ -0,0 +1,179 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "access_policy.h"
+#include "span.h"
+
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // double_buffered_queue
+  // -----------------------------------------------------------------------------
+
+  // Bounded queue for any number of producer threads and one consumer thread that consumes
+  // in bulk, usable as collection_t of basic_async_stream and basic_async_observer (see
+  // basic_async_observer::process_event_batch).
+  //
+  // Producers append to the front buffer under a spin lock. consume_batch swaps the front
+  // buffer with the consumer owned back buffer - the only time the consumer synchronizes -
+  // and hands the events to the consumer as one contiguous span. Both buffers keep their
+  // capacity, so once warmed up neither side allocates.
+  // capacity_ is per buffer, i.e. up to capacity_ events can be pushed while the consumer
+  // still works on the previous batch. Moving the queue is not thread-safe.
+  template< typename event_t >
+  class double_buffered_queue
+  {
+    using lock_t = std::lock_guard< access_policy::spin_mutex >;
+
+  public:
+
+    double_buffered_queue( size_t capacity_ )
+      : m_capacity( capacity_ )
+    {
+      m_front.reserve( capacity_ );
+      m_back.reserve( capacity_ );
+    }
+
+    double_buffered_queue( const double_buffered_queue& ) = delete;
+    double_buffered_queue& operator= ( const double_buffered_queue& ) = delete;
+
+    double_buffered_queue( double_buffered_queue&& other_ ) { *this = std::move( other_ ); }
+    double_buffered_queue& operator= ( double_buffered_queue&& other_ )
+    {
+      if( this == &other_ )
+        return *this;
+
+      m_capacity = other_.m_capacity;
+      m_front = std::move( other_.m_front );
+      m_back = std::move( other_.m_back );
+      m_backIndex = other_.m_backIndex;
+
+      other_.m_capacity = 0;
+      other_.m_backIndex = 0;
+      return *this;
+    }
+
+    bool push( const event_t& e_ )
+    {
+      lock_t l( m_mutex );
+      if( m_front.size() >= m_capacity )
+        return false;
+      m_front.push_back( e_ );
+      return true;
+    }
+
+    bool push( event_t&& e_ )
+    {
+      lock_t l( m_mutex );
+      if( m_front.size() >= m_capacity )
+        return false;
+      m_front.push_back( std::move( e_ ) );
+      return true;
+    }
+
+    // Consumer only. Invokes fn_( span< event_t > ) with all events pushed so far and returns
+    // their number. The events may be moved from, they are destroyed once fn_ returns.
+    // fn_ is called twice if events taken via consume_one are left from the previous batch
+    template< typename fn_t >
+    size_t consume_batch( fn_t&& fn_ )
+    {
+      size_t count = 0;
+      if( m_backIndex < m_back.size() )
+      {
+        count += m_back.size() - m_backIndex;
+        fn_( span< event_t >( m_back.data() + m_backIndex, m_back.data() + m_back.size() ) );
+      }
+      recycle_back();
+
+      swap_buffers();
+      if( !m_back.empty() )
+      {
+        count += m_back.size();
+        fn_( span< event_t >( m_back ) );
+      }
+      recycle_back();
+      return count;
+    }
+
+    // Consumer only. Takes events one by one out of the back buffer, swapping the buffers
+    // whenever it runs empty
+    template< typename fn_t >
+    bool consume_one( fn_t&& fn_ )
+    {
+      if( m_backIndex == m_back.size() )
+      {
+        recycle_back();
+        swap_buffers();
+        if( m_back.empty() )
+          return false;
+      }
+
+      fn_( m_back[ m_backIndex++ ] );
+      return true;
+    }
+
+    bool pop( event_t& e_ )
+    {
+      return consume_one( [&e_]( event_t& front_ ) { e_ = std::move( front_ ); } );
+    }
+
+    // consumer only
+    size_t size() const
+    {
+      lock_t l( m_mutex );
+      return m_front.size() + ( m_back.size() - m_backIndex );
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return m_capacity; }
+
+  private:
+
+    void swap_buffers()
+    {
+      lock_t l( m_mutex );
+      m_front.swap( m_back );
+    }
+
+    void recycle_back()
+    {
+      m_back.clear();
+      m_backIndex = 0;
+    }
+
+
+    size_t m_capacity;
+    mutable access_policy::spin_mutex m_mutex;
+    std::vector< event_t > m_front;
+    std::vector< event_t > m_back;  // consumer owned
+    size_t m_backIndex = 0;         // next event for consume_one
+  };
+
+}
+}
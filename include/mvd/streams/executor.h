@@ -0,0 +1,75 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // runnable
+  // -----------------------------------------------------------------------------
+
+  // a unit of work an executor runs whenever it has been scheduled, e.g. an async stream
+  // dispatching its queued events
+  class runnable
+  {
+  public:
+
+    runnable() = default;
+    virtual ~runnable() = default;
+
+    // the scheduling state belongs to the executor, copies start out unscheduled
+    runnable( const runnable& ) {}
+    runnable& operator= ( const runnable& ) { return *this; }
+
+    virtual void run() = 0;
+
+    // for use by executors that need to track per-runnable state, e.g. whether it is queued
+    std::atomic< unsigned >& schedule_state() { return m_scheduleState; }
+
+  private:
+
+    std::atomic< unsigned > m_scheduleState{ 0 };
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // executor
+  // -----------------------------------------------------------------------------
+
+  // runs runnables on some thread(s). A runnable is attached once and then scheduled
+  // every time it has new work, which must be cheap since it's called on every push.
+  // Once detach returns, the runnable isn't run anymore.
+  class executor
+  {
+  public:
+
+    virtual ~executor() = default;
+
+    virtual void attach( runnable& r_ ) = 0;
+    virtual void detach( runnable& r_ ) = 0;
+    virtual void schedule( runnable& r_ ) = 0;
+  };
+
+}
+}
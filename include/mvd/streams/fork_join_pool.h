@@ -0,0 +1,171 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // fork_join_pool
+  // -----------------------------------------------------------------------------
+
+  // Thread pool for running one loop at a time in parallel, e.g. notifying the observers of
+  // a stream concurrently (see basic_stream::set_parallel_dispatch). The calling thread
+  // takes part in the loop, so a pool with n threads runs up to n + 1 iterations at once.
+  //
+  // parallel_for returns once all iterations have returned, i.e. it is a completion barrier.
+  // If the pool is already running a loop for another thread, or parallel_for is called from
+  // one of the pool's threads, the loop runs on the calling thread instead - so nested and
+  // concurrent calls never block on each other.
+  class fork_join_pool
+  {
+  public:
+
+    explicit fork_join_pool( size_t threadCount_ = std::max( 1u, std::thread::hardware_concurrency() ) - 1 )
+    {
+      for( size_t i = 0; i < threadCount_; ++i )
+        m_threads.emplace_back( [this]() { loop(); } );
+    }
+
+    ~fork_join_pool()
+    {
+      {
+        std::lock_guard< std::mutex > l( m_mutex );
+        m_stopped = true;
+        m_start.notify_all();
+      }
+      for( auto& t : m_threads )
+        t.join();
+    }
+
+    fork_join_pool( const fork_join_pool& ) = delete;
+    fork_join_pool& operator= ( const fork_join_pool& ) = delete;
+
+    // number of threads a loop runs on, including the calling one
+    size_t concurrency() const { return m_threads.size() + 1; }
+
+    // calls fn_( i ) for every i in [0, count_). fn_ is called concurrently and must not throw
+    template< typename fn_t >
+    void parallel_for( size_t count_, fn_t&& fn_ )
+    {
+      std::unique_lock< std::mutex > busy( m_callMutex, std::try_to_lock );
+      if( count_ < 2 || m_threads.empty() || is_pool_thread() || !busy )
+      {
+        for( size_t i = 0; i < count_; ++i )
+          fn_( i );
+        return;
+      }
+
+      using target_t = std::remove_reference_t< fn_t >;
+      {
+        std::lock_guard< std::mutex > l( m_mutex );
+        m_invoke = []( void* fn_, size_t i_ ) { ( *static_cast< target_t* >( fn_ ) )( i_ ); };
+        m_target = const_cast< void* >( static_cast< const void* >( &fn_ ) );
+        m_count = count_;
+        m_next.store( 0 );
+        m_active = true;
+        ++m_generation;
+      }
+      m_start.notify_all();
+
+      run();
+
+      // all iterations are taken, only wait for the threads still running one
+      std::unique_lock< std::mutex > l( m_mutex );
+      m_active = false;
+      m_finished.wait( l, [this]() { return m_busyCount == 0; } );
+    }
+
+  private:
+
+    bool is_pool_thread() const { return this_thread_pool() == this; }
+
+    static const fork_join_pool*& this_thread_pool()
+    {
+      static thread_local const fork_join_pool* pool = nullptr;
+      return pool;
+    }
+
+    void run()
+    {
+      for( ;; )
+      {
+        auto i = m_next.fetch_add( 1 );
+        if( i >= m_count )
+          return;
+        m_invoke( m_target, i );
+      }
+    }
+
+    void loop()
+    {
+      this_thread_pool() = this;
+
+      size_t generation = 0;
+      for( ;; )
+      {
+        {
+          std::unique_lock< std::mutex > l( m_mutex );
+          m_start.wait( l, [&]() { return m_stopped || ( m_active && m_generation != generation ); } );
+          if( m_stopped )
+            return;
+
+          generation = m_generation;
+          ++m_busyCount;
+        }
+
+        run();
+
+        std::lock_guard< std::mutex > l( m_mutex );
+        if( --m_busyCount == 0 )
+          m_finished.notify_one();
+      }
+    }
+
+
+    // the current loop, written under m_mutex before it is started
+    void ( *m_invoke )( void*, size_t ) = nullptr;
+    void* m_target = nullptr;
+    size_t m_count = 0;
+    std::atomic< size_t > m_next{ 0 };
+
+    std::mutex m_callMutex;  // held by the thread running a loop
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_finished;
+    size_t m_generation = 0;
+    size_t m_busyCount = 0;
+    bool m_active = false;
+    bool m_stopped = false;
+
+    std::vector< std::thread > m_threads;
+  };
+
+}
+}
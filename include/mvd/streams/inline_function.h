@@ -0,0 +1,312 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Default inline capacity of inline_function in bytes - large enough for a std::function or a
+// lambda capturing a handful of pointers
+#ifndef MVD_STREAMS_INLINE_FUNCTION_CAPACITY
+#define MVD_STREAMS_INLINE_FUNCTION_CAPACITY ( 6 * sizeof( void* ) )
+#endif
+
+// Define MVD_STREAMS_INLINE_FUNCTION_STRICT to turn callables that don't fit into the inline
+// storage into a compile error instead of allocating them on the heap
+//#define MVD_STREAMS_INLINE_FUNCTION_STRICT
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // inline_function_storage
+  // -----------------------------------------------------------------------------
+
+  template< typename signature_t, size_t capacity_ >
+  class inline_function_storage;
+
+  template< typename result_t, typename... args_t, size_t capacity_ >
+  class inline_function_storage< result_t( args_t... ), capacity_ >
+  {
+    struct vtable_t
+    {
+      result_t ( *invoke )( void* target_, args_t&&... args_ );
+      void ( *move )( void* dst_, void* src_ ) noexcept;  // move-constructs dst_, destroys src_
+      void ( *copy )( void* dst_, const void* src_ );
+      void ( *destroy )( void* target_ ) noexcept;
+    };
+
+    template< typename fn_t >
+    struct is_stored_inline : std::integral_constant< bool,
+      sizeof( fn_t ) <= capacity_ &&
+      alignof( fn_t ) <= alignof( std::max_align_t ) &&
+      std::is_nothrow_move_constructible< fn_t >::value
+    > {};
+
+    template< typename fn_t >
+    struct inline_target
+    {
+      static fn_t& get( void* p_ ) { return *static_cast< fn_t* >( p_ ); }
+
+      static result_t invoke( void* p_, args_t&&... args_ )
+      {
+        return get( p_ )( std::forward< args_t >( args_ )... );
+      }
+
+      static void move( void* dst_, void* src_ ) noexcept
+      {
+        new ( dst_ ) fn_t( std::move( get( src_ ) ) );
+        get( src_ ).~fn_t();
+      }
+
+      static void copy( void* dst_, const void* src_ )
+      {
+        new ( dst_ ) fn_t( *static_cast< const fn_t* >( src_ ) );
+      }
+
+      static void destroy( void* p_ ) noexcept { get( p_ ).~fn_t(); }
+
+      template< typename arg_t >
+      static void create( void* p_, arg_t&& fn_ ) { new ( p_ ) fn_t( std::forward< arg_t >( fn_ ) ); }
+    };
+
+    template< typename fn_t >
+    struct heap_target
+    {
+      static fn_t& get( void* p_ ) { return **static_cast< fn_t** >( p_ ); }
+
+      static result_t invoke( void* p_, args_t&&... args_ )
+      {
+        return get( p_ )( std::forward< args_t >( args_ )... );
+      }
+
+      static void move( void* dst_, void* src_ ) noexcept
+      {
+        *static_cast< fn_t** >( dst_ ) = *static_cast< fn_t** >( src_ );
+      }
+
+      static void copy( void* dst_, const void* src_ )
+      {
+        *static_cast< fn_t** >( dst_ ) = new fn_t( **static_cast< fn_t* const* >( src_ ) );
+      }
+
+      static void destroy( void* p_ ) noexcept { delete *static_cast< fn_t** >( p_ ); }
+
+      template< typename arg_t >
+      static void create( void* p_, arg_t&& fn_ )
+      {
+        *static_cast< fn_t** >( p_ ) = new fn_t( std::forward< arg_t >( fn_ ) );
+      }
+    };
+
+    template< typename fn_t >
+    using target_t = std::conditional_t< is_stored_inline< fn_t >::value, inline_target< fn_t >, heap_target< fn_t > >;
+
+    // the copy operation must not be instantiated for move-only targets
+    template< typename target >
+    static decltype( &target::copy ) copy_op( std::true_type ) { return &target::copy; }
+
+    template< typename target >
+    static decltype( &target::copy ) copy_op( std::false_type ) { return nullptr; }
+
+    template< typename fn_t, bool copyable_ >
+    static const vtable_t* vtable_for()
+    {
+      using target = target_t< fn_t >;
+      static const vtable_t vtable = {
+        &target::invoke,
+        &target::move,
+        copy_op< target >( std::integral_constant< bool, copyable_ >() ),
+        &target::destroy
+      };
+      return &vtable;
+    }
+
+  public:
+
+    inline_function_storage() = default;
+    ~inline_function_storage() { reset(); }
+
+    inline_function_storage( const inline_function_storage& other_ ) { *this = other_; }
+    inline_function_storage& operator= ( const inline_function_storage& other_ )
+    {
+      if( this == &other_ )
+        return *this;
+
+      reset();
+      if( other_.m_vtable )
+      {
+        other_.m_vtable->copy( &m_storage, &other_.m_storage );
+        m_vtable = other_.m_vtable;
+      }
+      return *this;
+    }
+
+    inline_function_storage( inline_function_storage&& other_ ) noexcept { *this = std::move( other_ ); }
+    inline_function_storage& operator= ( inline_function_storage&& other_ ) noexcept
+    {
+      if( this == &other_ )
+        return *this;
+
+      reset();
+      if( other_.m_vtable )
+      {
+        other_.m_vtable->move( &m_storage, &other_.m_storage );
+        m_vtable = other_.m_vtable;
+        other_.m_vtable = nullptr;
+      }
+      return *this;
+    }
+
+    template< bool copyable_, typename fn_t >
+    void assign( fn_t&& fn_ )
+    {
+      using target_fn_t = std::decay_t< fn_t >;
+
+#ifdef MVD_STREAMS_INLINE_FUNCTION_STRICT
+      static_assert( is_stored_inline< target_fn_t >::value, "callable does not fit into the inline storage" );
+#endif
+      static_assert( !copyable_ || std::is_copy_constructible< target_fn_t >::value, "callable is not copyable" );
+
+      reset();
+      target_t< target_fn_t >::create( &m_storage, std::forward< fn_t >( fn_ ) );
+      m_vtable = vtable_for< target_fn_t, copyable_ >();
+    }
+
+    void reset() noexcept
+    {
+      if( m_vtable )
+      {
+        m_vtable->destroy( &m_storage );
+        m_vtable = nullptr;
+      }
+    }
+
+    bool empty() const noexcept { return m_vtable == nullptr; }
+
+    result_t invoke( args_t... args_ ) const noexcept
+    {
+      assert( m_vtable && "invoking empty inline_function" );
+      return m_vtable->invoke( &m_storage, std::forward< args_t >( args_ )... );
+    }
+
+  private:
+
+    const vtable_t* m_vtable = nullptr;
+    alignas( std::max_align_t ) mutable unsigned char m_storage[ capacity_ < sizeof( void* ) ? sizeof( void* ) : capacity_ ];
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // basic_inline_function
+  // -----------------------------------------------------------------------------
+
+  template< bool copyable_ >
+  struct inline_function_copy_guard {};
+
+  template<>
+  struct inline_function_copy_guard< false >
+  {
+    inline_function_copy_guard() = default;
+    inline_function_copy_guard( const inline_function_copy_guard& ) = delete;
+    inline_function_copy_guard& operator= ( const inline_function_copy_guard& ) = delete;
+    inline_function_copy_guard( inline_function_copy_guard&& ) = default;
+    inline_function_copy_guard& operator= ( inline_function_copy_guard&& ) = default;
+  };
+
+
+  // Type-erased callable that stores its target in an inline buffer of capacity_ bytes rather
+  // than on the heap (unless the target doesn't fit, see MVD_STREAMS_INLINE_FUNCTION_STRICT).
+  // Invoking it is noexcept - a target that throws terminates the program - and invoking an
+  // empty basic_inline_function is undefined.
+  template< typename signature_t, size_t capacity_, bool copyable_ >
+  class basic_inline_function;
+
+  template< typename result_t, typename... args_t, size_t capacity_, bool copyable_ >
+  class basic_inline_function< result_t( args_t... ), capacity_, copyable_ >
+    : private inline_function_copy_guard< copyable_ >
+  {
+    template< typename fn_t, typename = void >
+    struct is_callable : std::false_type {};
+
+    template< typename fn_t >
+    struct is_callable< fn_t, decltype( void( std::declval< fn_t& >()( std::declval< args_t >()... ) ) ) >
+      : std::integral_constant< bool,
+          std::is_void< result_t >::value ||
+          std::is_convertible< decltype( std::declval< fn_t& >()( std::declval< args_t >()... ) ), result_t >::value
+        >
+    {};
+
+    template< typename fn_t >
+    using enable_if_target_t = std::enable_if_t<
+      !std::is_same< std::decay_t< fn_t >, basic_inline_function >::value &&
+      is_callable< std::decay_t< fn_t > >::value
+    >;
+
+  public:
+
+    basic_inline_function() = default;
+    basic_inline_function( std::nullptr_t ) {}
+
+    template< typename fn_t, typename = enable_if_target_t< fn_t > >
+    basic_inline_function( fn_t&& fn_ )
+    {
+      m_target.template assign< copyable_ >( std::forward< fn_t >( fn_ ) );
+    }
+
+    template< typename fn_t, typename = enable_if_target_t< fn_t > >
+    basic_inline_function& operator= ( fn_t&& fn_ )
+    {
+      m_target.template assign< copyable_ >( std::forward< fn_t >( fn_ ) );
+      return *this;
+    }
+
+    basic_inline_function& operator= ( std::nullptr_t )
+    {
+      m_target.reset();
+      return *this;
+    }
+
+    explicit operator bool() const noexcept { return !m_target.empty(); }
+
+    result_t operator()( args_t... args_ ) const noexcept
+    {
+      return m_target.invoke( std::forward< args_t >( args_ )... );
+    }
+
+  private:
+
+    inline_function_storage< result_t( args_t... ), capacity_ > m_target;
+  };
+
+
+  template< typename signature_t, size_t capacity_ = MVD_STREAMS_INLINE_FUNCTION_CAPACITY >
+  using inline_function = basic_inline_function< signature_t, capacity_, false >;
+
+  // for callables that have to be duplicated when their owner is copied, e.g. operators
+  template< typename signature_t, size_t capacity_ = MVD_STREAMS_INLINE_FUNCTION_CAPACITY >
+  using copyable_inline_function = basic_inline_function< signature_t, capacity_, true >;
+
+}
+}
@@ -0,0 +1,194 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // mpsc_queue
+  // -----------------------------------------------------------------------------
+
+  // Bounded lock-free queue for any number of producer threads (push) and a single consumer
+  // thread (pop / consume_one), usable as collection_t of basic_async_stream and
+  // basic_async_observer.
+  //
+  // Based on Dmitry Vyukov's bounded MPMC queue: every slot of the power-of-two ring buffer
+  // carries a sequence number telling whether it is ready to be written or read in the
+  // current lap. Producers claim a slot by advancing the shared enqueue position with a CAS
+  // and publish the event by bumping the slot's sequence number, so they only contend on
+  // that one counter and never wait for each other to finish writing. With a single consumer
+  // the dequeue position needs no atomic read-modify-write at all.
+  // The capacity is rounded up to a power of two of at least 2: with a single slot the
+  // sequence number of a written slot equals the one of the free slot in the next lap, so
+  // producers would overwrite unread events. Moving the queue is not thread-safe.
+  template< typename event_t >
+  class mpsc_queue
+  {
+    struct cell_t
+    {
+      std::atomic< size_t > sequence;
+      typename std::aligned_storage< sizeof( event_t ), alignof( event_t ) >::type storage;
+
+      event_t& event() { return *reinterpret_cast< event_t* >( &storage ); }
+    };
+
+    static constexpr size_t cache_line_size = 64;
+
+  public:
+
+    mpsc_queue( size_t capacity_ )
+      : m_mask( round_up_to_power_of_two( capacity_ ) - 1 )
+      , m_cells( new cell_t[ m_mask + 1 ] )
+    {
+      for( size_t i = 0; i <= m_mask; ++i )
+        m_cells[i].sequence.store( i, std::memory_order_relaxed );
+    }
+
+    ~mpsc_queue() { clear(); }
+
+    mpsc_queue( const mpsc_queue& ) = delete;
+    mpsc_queue& operator= ( const mpsc_queue& ) = delete;
+
+    mpsc_queue( mpsc_queue&& other_ ) { *this = std::move( other_ ); }
+    mpsc_queue& operator= ( mpsc_queue&& other_ )
+    {
+      if( this == &other_ )
+        return *this;
+
+      clear();
+      m_mask = other_.m_mask;
+      m_cells = std::move( other_.m_cells );
+      m_enqueuePos.store( other_.m_enqueuePos.load() );
+      m_dequeuePos = other_.m_dequeuePos;
+
+      other_.m_enqueuePos.store( 0 );
+      other_.m_dequeuePos = 0;
+      return *this;
+    }
+
+
+    // producer side, thread-safe
+
+    bool push( const event_t& e_ ) { return emplace( e_ ); }
+    bool push( event_t&& e_ ) { return emplace( std::move( e_ ) ); }
+
+    // consumer side
+
+    bool pop( event_t& e_ )
+    {
+      return consume_one( [&e_]( event_t& front_ ) { e_ = std::move( front_ ); } );
+    }
+
+    // invokes fn_ with the oldest event in place, then removes it
+    template< typename fn_t >
+    bool consume_one( fn_t&& fn_ )
+    {
+      if( !m_cells )
+        return false;
+
+      auto& cell = m_cells[ m_dequeuePos & m_mask ];
+      if( cell.sequence.load( std::memory_order_acquire ) != m_dequeuePos + 1 )
+        return false;
+
+      fn_( cell.event() );
+      cell.event().~event_t();
+      cell.sequence.store( m_dequeuePos + m_mask + 1, std::memory_order_release );
+      ++m_dequeuePos;
+      return true;
+    }
+
+    // consumer side, a snapshot that includes events whose push is still in progress
+    size_t size() const
+    {
+      return m_enqueuePos.load( std::memory_order_acquire ) - m_dequeuePos;
+    }
+
+    bool empty() const { return size() == 0; }
+
+  private:
+
+    static size_t round_up_to_power_of_two( size_t n_ )
+    {
+      size_t p = 2;
+      while( p < n_ )
+        p <<= 1;
+      return p;
+    }
+
+    template< typename arg_t >
+    bool emplace( arg_t&& e_ )
+    {
+      if( !m_cells )
+        return false;
+
+      cell_t* cell;
+      auto pos = m_enqueuePos.load( std::memory_order_relaxed );
+      for( ;; )
+      {
+        cell = &m_cells[ pos & m_mask ];
+        auto sequence = cell->sequence.load( std::memory_order_acquire );
+        auto diff = static_cast< std::intptr_t >( sequence ) - static_cast< std::intptr_t >( pos );
+
+        if( diff == 0 )
+        {
+          // the slot is free in this lap, try to claim it
+          if( m_enqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+            break;
+        }
+        else if( diff < 0 )
+          return false;  // the slot still holds the event of the previous lap, i.e. full
+        else
+          pos = m_enqueuePos.load( std::memory_order_relaxed );
+      }
+
+      new ( &cell->storage ) event_t( std::forward< arg_t >( e_ ) );
+      cell->sequence.store( pos + 1, std::memory_order_release );
+      return true;
+    }
+
+    void clear()
+    {
+      while( consume_one( []( event_t& ) {} ) ) {}
+    }
+
+
+    // read-only after construction
+    size_t m_mask = 0;
+    std::unique_ptr< cell_t[] > m_cells;
+
+    // producers
+    alignas( cache_line_size ) std::atomic< size_t > m_enqueuePos{ 0 };
+
+    // consumer
+    alignas( cache_line_size ) size_t m_dequeuePos = 0;
+  };
+
+}
+}
@@ -0,0 +1,236 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+
+  template< typename T >
+  class object_pool;
+
+  namespace detail
+  {
+    template< typename T >
+    struct pool_slot
+    {
+      T object;
+      std::atomic< unsigned > refCount{ 0 };
+      object_pool< T >* pool = nullptr;
+      pool_slot* next = nullptr;
+    };
+  }
+
+
+  // -----------------------------------------------------------------------------
+  // pooled_ptr
+  // -----------------------------------------------------------------------------
+
+  // reference counted handle to an object of an object_pool. The object goes back to its
+  // pool once the last handle to it is destroyed, on whatever thread that happens. Moving
+  // a handle doesn't touch the reference count. Handles sharing an object may be used from
+  // different threads, but the object itself is not synchronized - treat it as read-only
+  // once it has been shared
+  template< typename T >
+  class pooled_ptr
+  {
+    friend class object_pool< T >;
+    using slot_t = detail::pool_slot< T >;
+
+  public:
+
+    pooled_ptr() = default;
+    ~pooled_ptr() { reset(); }
+
+    pooled_ptr( const pooled_ptr& other_ ) { *this = other_; }
+    pooled_ptr& operator= ( const pooled_ptr& other_ )
+    {
+      if( other_.m_slot )
+        other_.m_slot->refCount.fetch_add( 1, std::memory_order_relaxed );
+      reset();
+      m_slot = other_.m_slot;
+      return *this;
+    }
+
+    pooled_ptr( pooled_ptr&& other_ ) noexcept : m_slot( other_.m_slot ) { other_.m_slot = nullptr; }
+    pooled_ptr& operator= ( pooled_ptr&& other_ ) noexcept
+    {
+      if( this == &other_ )
+        return *this;
+
+      reset();
+      m_slot = other_.m_slot;
+      other_.m_slot = nullptr;
+      return *this;
+    }
+
+    void reset();
+
+    T* get() const { return m_slot ? &m_slot->object : nullptr; }
+    T& operator* () const { return m_slot->object; }
+    T* operator-> () const { return &m_slot->object; }
+
+    explicit operator bool() const { return m_slot != nullptr; }
+
+    unsigned use_count() const { return m_slot ? m_slot->refCount.load( std::memory_order_relaxed ) : 0; }
+
+  private:
+
+    explicit pooled_ptr( slot_t* slot_ ) : m_slot( slot_ ) {}
+
+    slot_t* m_slot = nullptr;
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // object_pool
+  // -----------------------------------------------------------------------------
+
+  // Pool of preallocated objects for large event payloads, so async streams can carry a
+  // pooled_ptr instead of the payload itself. Objects are recycled rather than destroyed:
+  // acquire returns an object in whatever state its last user left it in, so e.g. a vector
+  // member keeps its capacity and refilling it doesn't allocate.
+  //
+  // A pool belongs to the thread that creates it (typically a producer), only that thread
+  // may call acquire. Objects are returned from any thread: the owner puts them straight
+  // back into its free list, other threads push them onto a lock-free stack that the owner
+  // takes over in one go once its free list runs empty. So neither side ever calls malloc
+  // or free for a recycled payload.
+  // The pool has to outlive all handles to its objects. T has to be default constructible.
+  template< typename T >
+  class object_pool
+  {
+    friend class pooled_ptr< T >;
+    using slot_t = detail::pool_slot< T >;
+
+  public:
+
+    explicit object_pool( size_t chunkSize_ = 64 )
+      : m_chunkSize( chunkSize_ > 0 ? chunkSize_ : 1 )
+      , m_owner( std::this_thread::get_id() )
+    {}
+
+    ~object_pool()
+    {
+      assert( m_acquired.load() == 0 && "object_pool destroyed while objects are still in use" );
+    }
+
+    object_pool( const object_pool& ) = delete;
+    object_pool& operator= ( const object_pool& ) = delete;
+
+    // owner thread only
+    pooled_ptr< T > acquire()
+    {
+      assert( std::this_thread::get_id() == m_owner && "object_pool::acquire called from a foreign thread" );
+
+      if( !m_freeList )
+        m_freeList = m_remoteFreeList.exchange( nullptr, std::memory_order_acquire );
+      if( !m_freeList )
+        add_chunk();
+
+      slot_t* s = m_freeList;
+      m_freeList = s->next;
+      s->refCount.store( 1, std::memory_order_relaxed );
+      m_acquired.fetch_add( 1, std::memory_order_relaxed );
+      return pooled_ptr< T >( s );
+    }
+
+    // owner thread only. Makes sure count_ objects can be acquired without allocating
+    void reserve( size_t count_ )
+    {
+      while( capacity() < count_ )
+        add_chunk();
+    }
+
+    size_t capacity() const { return m_chunks.size() * m_chunkSize; }
+
+    // objects currently handed out
+    size_t acquired() const { return m_acquired.load( std::memory_order_relaxed ); }
+
+  private:
+
+    void release( slot_t* s_ )
+    {
+      m_acquired.fetch_sub( 1, std::memory_order_relaxed );
+
+      if( std::this_thread::get_id() == m_owner )
+      {
+        s_->next = m_freeList;
+        m_freeList = s_;
+        return;
+      }
+
+      auto head = m_remoteFreeList.load( std::memory_order_relaxed );
+      do
+      {
+        s_->next = head;
+      }
+      while( !m_remoteFreeList.compare_exchange_weak( head, s_, std::memory_order_release, std::memory_order_relaxed ) );
+    }
+
+    void add_chunk()
+    {
+      m_chunks.push_back( std::make_unique< slot_t[] >( m_chunkSize ) );
+
+      auto slots = m_chunks.back().get();
+      for( size_t i = m_chunkSize; i-- > 0; )
+      {
+        slots[i].pool = this;
+        slots[i].next = m_freeList;
+        m_freeList = &slots[i];
+      }
+    }
+
+
+    const size_t m_chunkSize;
+    const std::thread::id m_owner;
+
+    std::vector< std::unique_ptr< slot_t[] > > m_chunks;
+    slot_t* m_freeList = nullptr;
+    std::atomic< slot_t* > m_remoteFreeList{ nullptr };
+    std::atomic< size_t > m_acquired{ 0 };
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // implementation
+  // -----------------------------------------------------------------------------
+
+  template< typename T >
+  inline void pooled_ptr< T >::reset()
+  {
+    if( !m_slot )
+      return;
+
+    if( m_slot->refCount.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+      m_slot->pool->release( m_slot );
+    m_slot = nullptr;
+  }
+
+}
+}
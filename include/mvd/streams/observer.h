@@ -18,9 +18,9 @@
 
 #pragma once
 
-#include <vector>
-#include <algorithm>
-#include <functional>
+#include "observer_list.h"
+
+#include <utility>
 
 namespace mvd
 {
@@ -34,6 +34,9 @@ namespace streams
   template< typename access_policy_t >
   class observer_base;
 
+  template< typename access_policy_t >
+  class scoped_subscription;
+
   template< typename access_policy_t >
   class observable_base
   {
@@ -57,9 +60,7 @@ namespace streams
     {
       // we implement this in order to not restrict derived classes
       // moving basic_observer ptrs is not really intuitive, so just unregister them
-      for( auto o : other_.m_observers )
-        o->stop_observing();
-      other_.m_observers.clear();
+      other_.m_observers.clear( []( observer_base_t& o_ ) { o_.stop_observing(); } );
       return *this;
     }
 
@@ -70,18 +71,33 @@ namespace streams
     
   protected:
 
-    void for_each_observer( const std::function< void( observer_base_t& ) >& fn_ )
+    // fn_ is taken as a template parameter rather than a std::function so the visitation
+    // can be inlined into the dispatch loop
+    template< typename fn_t >
+    void for_each_observer( fn_t&& fn_ )
+    {
+      m_observers.for_each( std::forward< fn_t >( fn_ ) );
+    }
+
+    // same as above, but the last observer is visited with lastFn_ instead
+    template< typename fn_t, typename last_fn_t >
+    void for_each_observer( fn_t&& fn_, last_fn_t&& lastFn_ )
+    {
+      m_observers.for_each( std::forward< fn_t >( fn_ ), std::forward< last_fn_t >( lastFn_ ) );
+    }
+
+    // invokes fn_( observers, count ) with a copy of the observer list, without holding its
+    // lock (see observer_list::with_snapshot), e.g. to visit the observers in parallel
+    template< typename fn_t >
+    void with_observer_snapshot( fn_t&& fn_ )
     {
-      auto l = access_policy_t::scoped_lock( m_mutex );
-      for ( auto o : m_observers )
-        fn_( *o );
+      m_observers.with_snapshot( std::forward< fn_t >( fn_ ) );
     }
 
 
   private:
 
-    std::vector< observer_base_t* > m_observers;
-    typename access_policy_t::mutex_t m_mutex;
+    observer_list< observer_base_t, access_policy_t > m_observers;
   };
 
 
@@ -91,16 +107,23 @@ namespace streams
   // -----------------------------------------------------------------------------
 
   template< typename access_policy_t >
-  class observer_base
+  class observer_base : public observer_list_hook< observer_base< access_policy_t > >
   {
     friend class observable_base< access_policy_t >;
+    friend class scoped_subscription< access_policy_t >;
+
+    using hook_t = observer_list_hook< observer_base< access_policy_t > >;
   public:
 
     observer_base() = default;
 
-    virtual ~observer_base() { unregister(); }
+    virtual ~observer_base()
+    {
+      unregister();
+      detach_subscription();
+    }
 
-    observer_base( const observer_base& other_ ) { *this = other_; }
+    observer_base( const observer_base& other_ ) : hook_t() { *this = other_; }
     observer_base& operator= ( const observer_base& other_ )
     {
       if( this == &other_ )
@@ -114,7 +137,7 @@ namespace streams
       return *this;
     }
 
-    observer_base( observer_base&& other_ ) { *this = std::move( other_ ); }
+    observer_base( observer_base&& other_ ) : hook_t() { *this = std::move( other_ ); }
     observer_base operator= ( observer_base&& other_ )
     {
       if ( other_.m_observable )
@@ -142,64 +165,135 @@ namespace streams
 
     void observe( observable_base_t& observable_ )
     {
+      // subscribing to the same observable again keeps a scoped_subscription bound
+      auto* subscription = &observable_ == m_observable ? std::exchange( m_subscription, nullptr ) : nullptr;
       unregister();
       m_observable = &observable_;
+      m_subscription = subscription;
     }
 
     void stop_observing()
     {
       m_observable = nullptr;
+      detach_subscription();
+    }
+
+    // the bound handle must not outlive our subscription, it would unsubscribe a dangling observer
+    void detach_subscription()
+    {
+      if( m_subscription )
+        std::exchange( m_subscription, nullptr )->m_observer = nullptr;
     }
 
 
     observable_base_t* m_observable = nullptr;
+    scoped_subscription< access_policy_t >* m_subscription = nullptr;
   };
 
 
   // -----------------------------------------------------------------------------
-  // implementation
+  // scoped_subscription
   // -----------------------------------------------------------------------------
 
+  // RAII handle that unsubscribes the observer when it goes out of scope, unless the
+  // observer has been unsubscribed or subscribed elsewhere in the meantime. The observer
+  // unbinds the handle when it stops observing or is destroyed, so either the observer or
+  // the observable may die first
   template< typename access_policy_t >
-  observable_base< access_policy_t >::~observable_base()
+  class scoped_subscription
   {
-    auto l = access_policy_t::scoped_lock( m_mutex );
-    for ( auto& o : m_observers )
+    friend class observer_base< access_policy_t >;
+
+    using observable_base_t = observable_base< access_policy_t >;
+    using observer_base_t = observer_base< access_policy_t >;
+
+  public:
+
+    scoped_subscription() = default;
+
+    scoped_subscription( observable_base_t& observable_, observer_base_t& observer_ )
     {
-      o->stop_observing();
+      observable_.register_observer( observer_ );
+      bind( observer_ );
     }
+
+    ~scoped_subscription() { reset(); }
+
+    scoped_subscription( const scoped_subscription& ) = delete;
+    scoped_subscription& operator= ( const scoped_subscription& ) = delete;
+
+    scoped_subscription( scoped_subscription&& other_ ) { *this = std::move( other_ ); }
+    scoped_subscription& operator= ( scoped_subscription&& other_ )
+    {
+      if( this == &other_ )
+        return *this;
+
+      reset();
+      if( auto* observer = other_.m_observer )
+      {
+        other_.release();
+        bind( *observer );
+      }
+      return *this;
+    }
+
+    // unsubscribes now
+    void reset()
+    {
+      // only bound while the observer is alive and still subscribed to our observable
+      if( m_observer )
+        m_observer->unregister();
+      release();
+    }
+
+    // keeps the subscription alive beyond the lifetime of the handle
+    void release()
+    {
+      if( m_observer )
+        std::exchange( m_observer, nullptr )->m_subscription = nullptr;
+    }
+
+    explicit operator bool() const { return m_observer != nullptr; }
+
+  private:
+
+    void bind( observer_base_t& observer_ )
+    {
+      observer_.detach_subscription();
+      observer_.m_subscription = this;
+      m_observer = &observer_;
+    }
+
+    observer_base_t* m_observer = nullptr;
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // implementation
+  // -----------------------------------------------------------------------------
+
+  template< typename access_policy_t >
+  observable_base< access_policy_t >::~observable_base()
+  {
+    m_observers.clear( []( observer_base_t& o_ ) { o_.stop_observing(); } );
   }
 
 
   template< typename access_policy_t >
   void observable_base< access_policy_t >::register_observer( observer_base< access_policy_t >& observer_base_ )
   {
-    // no check here - don't pay for what you don't use => users have to make sure they don't subscribe the
-    // same observer_base multiple times (and if they do, they need to remove it multiple times)
-    auto l = access_policy_t::scoped_lock( m_mutex );
+    // an observer observes one observable at a time, observe() unregisters it from its current
+    // one - so subscribing the same observer_base again just moves it to the end of the list
     observer_base_.observe( *this );
-    m_observers.push_back( &observer_base_ );
+    m_observers.add( &observer_base_ );
   }
 
 
   template< typename access_policy_t >
   void observable_base< access_policy_t >::unregister_observer( observer_base< access_policy_t >& observer_base_ )
   {
-    auto l = access_policy_t::scoped_lock( m_mutex );
-    
-    auto it = std::find_if(
-        m_observers.begin(),
-        m_observers.end(),
-        [&observer_base_]( observer_base< access_policy_t >* o_ )
-        {
-          return o_ == &observer_base_;          
-        }
-    );
-    if( it != m_observers.end() )
-    {
-      (*it)->stop_observing();
-      m_observers.erase( it );
-    }
+    if( m_observers.remove( &observer_base_ ) )
+      observer_base_.stop_observing();
   }
 
 }
@@ -0,0 +1,463 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "access_policy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // observer_list_hook
+  // -----------------------------------------------------------------------------
+
+  template< typename observer_t, typename access_policy_t >
+  class observer_list;
+
+  // links an observer into the observer_list it is currently in. observer_t has to derive
+  // from observer_list_hook< observer_t >. Copying an observer does not copy its links
+  template< typename observer_t >
+  class observer_list_hook
+  {
+    template< typename, typename >
+    friend class observer_list;
+
+  public:
+
+    observer_list_hook() = default;
+    observer_list_hook( const observer_list_hook& ) {}
+    observer_list_hook& operator= ( const observer_list_hook& ) { return *this; }
+
+  private:
+
+    const void* m_list = nullptr;
+    observer_t* m_prev = nullptr;
+    observer_t* m_next = nullptr;
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // observer_list
+  // -----------------------------------------------------------------------------
+
+  // storage for the observers of an observable_base. The default implementation is an
+  // intrusive doubly-linked list (see observer_list_hook), so adding and removing an
+  // observer is O(1) and doesn't touch any other entries. The list is guarded by the mutex
+  // of the access policy, exclusively for modification and shared for iteration.
+  // with_snapshot visits a copy of the list without holding the lock. Its readers are
+  // counted like those of the copy_on_write specialization, so remove() and clear() wait
+  // for the ones that may still see a removed observer before they return
+  template< typename observer_t, typename access_policy_t >
+  class observer_list
+  {
+    using hook_t = observer_list_hook< observer_t >;
+    using snapshot_t = std::vector< observer_t* >;
+
+    class read_guard
+    {
+    public:
+
+      read_guard( observer_list& list_ )
+        : m_counter( list_.m_readers[ list_.m_epoch.load() & 1u ] )
+      {
+        m_counter.fetch_add( 1 );
+      }
+
+      ~read_guard() { m_counter.fetch_sub( 1, std::memory_order_release ); }
+
+    private:
+
+      std::atomic< size_t >& m_counter;
+    };
+
+  public:
+
+    observer_list() = default;
+    observer_list( const observer_list& ) = delete;
+    observer_list& operator= ( const observer_list& ) = delete;
+
+    void add( observer_t* o_ )
+    {
+      auto l = access_policy_t::scoped_lock( m_mutex );
+
+      hook_t& h = *o_;
+      h.m_list = this;
+      h.m_prev = m_tail;
+      h.m_next = nullptr;
+
+      if( m_tail )
+        hook( *m_tail ).m_next = o_;
+      else
+        m_head = o_;
+      m_tail = o_;
+      ++m_size;
+      m_snapshotValid = false;
+    }
+
+    // returns false if o_ is not in this list
+    bool remove( observer_t* o_ )
+    {
+      if( !unlink_from_list( o_ ) )
+        return false;
+
+      wait_for_snapshot_readers();
+      return true;
+    }
+
+    template< typename fn_t >
+    void for_each( fn_t&& fn_ )
+    {
+      auto l = access_policy_t::scoped_shared_lock( m_mutex );
+      for( auto o = m_head; o; o = hook( *o ).m_next )
+        fn_( *o );
+    }
+
+    // invokes fn_ for all observers but the last one, and lastFn_ for the last one
+    template< typename fn_t, typename last_fn_t >
+    void for_each( fn_t&& fn_, last_fn_t&& lastFn_ )
+    {
+      auto l = access_policy_t::scoped_shared_lock( m_mutex );
+      if( !m_tail )
+        return;
+
+      for( auto o = m_head; o != m_tail; o = hook( *o ).m_next )
+        fn_( *o );
+      lastFn_( *m_tail );
+    }
+
+    // invokes fn_( observers, count ) with a contiguous copy of the list, e.g. to visit the
+    // observers in parallel. fn_ runs without the lock, so a slow visit doesn't hold up
+    // adding observers. The copy is cached and only rebuilt after the list has changed
+    template< typename fn_t >
+    void with_snapshot( fn_t&& fn_ )
+    {
+      // counted before the snapshot is taken, so a remove() can't miss this reader
+      read_guard g( *this );
+
+      std::shared_ptr< const snapshot_t > snapshot;
+      {
+        auto l = access_policy_t::scoped_shared_lock( m_mutex );
+        auto sl = access_policy_t::scoped_lock( m_snapshotMutex );
+        if( !m_snapshotValid )
+        {
+          // readers of the previous snapshot may still be visiting it
+          if( !m_snapshot || m_snapshot.use_count() > 1 )
+            m_snapshot = std::make_shared< snapshot_t >();
+
+          m_snapshot->clear();
+          m_snapshot->reserve( m_size );
+          for( auto o = m_head; o; o = hook( *o ).m_next )
+            m_snapshot->push_back( o );
+          m_snapshotValid = true;
+        }
+        snapshot = m_snapshot;
+      }
+      fn_( snapshot->data(), snapshot->size() );
+    }
+
+    // invokes fn_ for every observer, then removes all of them
+    template< typename fn_t >
+    void clear( fn_t&& fn_ )
+    {
+      {
+        auto l = access_policy_t::scoped_lock( m_mutex );
+        for( auto o = m_head; o; )
+        {
+          auto next = hook( *o ).m_next;
+          fn_( *o );
+          unlink( hook( *o ) );
+          o = next;
+        }
+        m_head = m_tail = nullptr;
+        m_size = 0;
+        m_snapshotValid = false;
+      }
+      wait_for_snapshot_readers();
+    }
+
+    size_t size() const { return m_size; }
+
+  private:
+
+    static hook_t& hook( observer_t& o_ ) { return o_; }
+
+    bool unlink_from_list( observer_t* o_ )
+    {
+      auto l = access_policy_t::scoped_lock( m_mutex );
+
+      hook_t& h = *o_;
+      if( h.m_list != this )
+        return false;
+
+      if( h.m_prev )
+        hook( *h.m_prev ).m_next = h.m_next;
+      else
+        m_head = h.m_next;
+
+      if( h.m_next )
+        hook( *h.m_next ).m_prev = h.m_prev;
+      else
+        m_tail = h.m_prev;
+
+      unlink( h );
+      --m_size;
+      m_snapshotValid = false;
+      return true;
+    }
+
+    // waits until every with_snapshot call that started before has returned. Two flips, as
+    // a reader may have picked up the epoch right before the first one
+    void wait_for_snapshot_readers()
+    {
+      auto l = access_policy_t::scoped_lock( m_epochMutex );
+      for( int i = 0; i < 2; ++i )
+      {
+        auto epoch = m_epoch.load() & 1u;
+        m_epoch.store( epoch ^ 1u );
+
+        while( m_readers[ epoch ].load() != 0 )
+          std::this_thread::yield();
+      }
+    }
+
+    static void unlink( hook_t& h_ )
+    {
+      h_.m_list = nullptr;
+      h_.m_prev = nullptr;
+      h_.m_next = nullptr;
+    }
+
+
+    observer_t* m_head = nullptr;
+    observer_t* m_tail = nullptr;
+    size_t m_size = 0;
+    typename access_policy_t::mutex_t m_mutex;
+
+    // cache for with_snapshot, invalidated under the exclusive lock by every modification
+    // and rebuilt under the shared one plus m_snapshotMutex
+    std::shared_ptr< snapshot_t > m_snapshot;
+    bool m_snapshotValid = false;
+    typename access_policy_t::mutex_t m_snapshotMutex;
+
+    std::atomic< size_t > m_readers[2] = {};
+    std::atomic< unsigned > m_epoch{ 0 };
+    typename access_policy_t::mutex_t m_epochMutex;  // serializes the epoch flips
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // observer_list (copy_on_write)
+  // -----------------------------------------------------------------------------
+
+  // Iteration reads an immutable snapshot of the observers that is published through an
+  // atomic pointer, so dispatching never takes a lock and any number of threads can dispatch
+  // concurrently. Modifications are serialized by the policy mutex, copy the current snapshot
+  // and publish the modified copy.
+  //
+  // Replaced snapshots are reclaimed once no reader can still be using them. Readers announce
+  // themselves in one of two counters (selected by the current epoch) on a per-thread stripe,
+  // writers flip the epoch and wait for the counters of the previous one to drain.
+  // - add() only retires the old snapshot, reclamation is deferred to a later remove() or
+  //   done in bulk once a few snapshots have been retired
+  // - remove() waits for all readers that might still see the removed observer, so once it
+  //   returns the observer won't be called anymore and can safely be destroyed
+  // As with access_policy::locked, observers must not subscribe or unsubscribe observers of
+  // the same observable from within a notification.
+  template< typename observer_t >
+  class observer_list< observer_t, access_policy::copy_on_write >
+  {
+    using snapshot_t = std::vector< observer_t* >;
+
+    static constexpr size_t stripe_count = 8;
+    static constexpr size_t max_retired_snapshots = 8;
+
+    struct alignas( 64 ) reader_stripe
+    {
+      std::atomic< size_t > readers[2];
+    };
+
+    class read_guard
+    {
+    public:
+
+      read_guard( const observer_list& list_ )
+        : m_counter( list_.m_stripes[ this_thread_stripe() ].readers[ list_.m_epoch.load() & 1u ] )
+      {
+        m_counter.fetch_add( 1 );
+        m_snapshot = list_.m_snapshot.load();
+      }
+
+      ~read_guard() { m_counter.fetch_sub( 1, std::memory_order_release ); }
+
+      const snapshot_t& snapshot() const { return *m_snapshot; }
+
+    private:
+
+      std::atomic< size_t >& m_counter;
+      const snapshot_t* m_snapshot;
+    };
+
+  public:
+
+    observer_list()
+    {
+      for( auto& s : m_stripes )
+      {
+        s.readers[0].store( 0 );
+        s.readers[1].store( 0 );
+      }
+    }
+
+    observer_list( const observer_list& ) = delete;
+    observer_list& operator= ( const observer_list& ) = delete;
+
+    ~observer_list()
+    {
+      delete m_snapshot.load();
+      for( auto s : m_retired )
+        delete s;
+    }
+
+    void add( observer_t* o_ )
+    {
+      auto l = access_policy::copy_on_write::scoped_lock( m_mutex );
+
+      auto next = new snapshot_t( *m_snapshot.load() );
+      next->push_back( o_ );
+      retire( m_snapshot.exchange( next ) );
+
+      if( m_retired.size() >= max_retired_snapshots )
+        reclaim();
+    }
+
+    bool remove( observer_t* o_ )
+    {
+      auto l = access_policy::copy_on_write::scoped_lock( m_mutex );
+
+      const auto& current = *m_snapshot.load();
+      auto it = std::find( current.begin(), current.end(), o_ );
+      if( it == current.end() )
+        return false;
+
+      auto next = new snapshot_t();
+      next->reserve( current.size() - 1 );
+      next->insert( next->end(), current.begin(), it );
+      next->insert( next->end(), it + 1, current.end() );
+
+      retire( m_snapshot.exchange( next ) );
+      reclaim();
+      return true;
+    }
+
+    template< typename fn_t >
+    void for_each( fn_t&& fn_ )
+    {
+      read_guard g( *this );
+      for( auto o : g.snapshot() )
+        fn_( *o );
+    }
+
+    template< typename fn_t, typename last_fn_t >
+    void for_each( fn_t&& fn_, last_fn_t&& lastFn_ )
+    {
+      read_guard g( *this );
+      const auto& observers = g.snapshot();
+      if( observers.empty() )
+        return;
+
+      auto last = observers.end() - 1;
+      for( auto it = observers.begin(); it != last; ++it )
+        fn_( **it );
+      lastFn_( **last );
+    }
+
+    template< typename fn_t >
+    void with_snapshot( fn_t&& fn_ )
+    {
+      read_guard g( *this );
+      fn_( g.snapshot().data(), g.snapshot().size() );
+    }
+
+    template< typename fn_t >
+    void clear( fn_t&& fn_ )
+    {
+      auto l = access_policy::copy_on_write::scoped_lock( m_mutex );
+
+      for( auto o : *m_snapshot.load() )
+        fn_( *o );
+
+      retire( m_snapshot.exchange( new snapshot_t() ) );
+      reclaim();
+    }
+
+    size_t size() const
+    {
+      read_guard g( *this );
+      return g.snapshot().size();
+    }
+
+  private:
+
+    static size_t this_thread_stripe()
+    {
+      static std::atomic< size_t > nextStripe{ 0 };
+      static thread_local size_t stripe = nextStripe.fetch_add( 1, std::memory_order_relaxed ) % stripe_count;
+      return stripe;
+    }
+
+    void retire( const snapshot_t* s_ ) { m_retired.push_back( s_ ); }
+
+    // waits until no reader can still hold a retired snapshot, then deletes them
+    void reclaim()
+    {
+      // two flips: a reader may have picked up the epoch right before the previous flip
+      for( int i = 0; i < 2; ++i )
+      {
+        auto epoch = m_epoch.load() & 1u;
+        m_epoch.store( epoch ^ 1u );
+
+        for( auto& s : m_stripes )
+          while( s.readers[ epoch ].load() != 0 )
+            std::this_thread::yield();
+      }
+
+      for( auto s : m_retired )
+        delete s;
+      m_retired.clear();
+    }
+
+
+    std::atomic< const snapshot_t* > m_snapshot{ new snapshot_t() };
+    std::atomic< unsigned > m_epoch{ 0 };
+    mutable reader_stripe m_stripes[ stripe_count ];
+
+    std::vector< const snapshot_t* > m_retired;
+    access_policy::copy_on_write::mutex_t m_mutex;
+  };
+
+}
+}
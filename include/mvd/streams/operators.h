@@ -20,17 +20,71 @@
 
 #include "basic_stream.h"
 
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 
 namespace mvd
 {
 namespace streams
 {
+  namespace detail
+  {
+    // Borrows a vector from a per-thread pool to build a batch in. on_events may run on several
+    // threads at once, so operators can't share a member buffer, and nested calls on one thread
+    // (e.g. chained filters) each borrow their own. Once the pool is warm, building a batch
+    // doesn't allocate
+    template< typename event_t >
+    class scratch_batch
+    {
+    public:
+
+      scratch_batch() : m_events( take() ) {}
+
+      ~scratch_batch()
+      {
+        m_events.clear();
+        pool().push_back( std::move( m_events ) );
+      }
+
+      scratch_batch( const scratch_batch& ) = delete;
+      scratch_batch& operator= ( const scratch_batch& ) = delete;
+
+      std::vector< event_t >& events() { return m_events; }
+
+    private:
+
+      static std::vector< std::vector< event_t > >& pool()
+      {
+        static thread_local std::vector< std::vector< event_t > > p;
+        return p;
+      }
+
+      static std::vector< event_t > take()
+      {
+        auto& p = pool();
+        if( p.empty() )
+          return std::vector< event_t >();
+
+        auto events = std::move( p.back() );
+        p.pop_back();
+        return events;
+      }
+
+
+      std::vector< event_t > m_events;
+    };
+  }
+
+
   // ---------------------------------------------------------------------------
   // filter_source
   // ---------------------------------------------------------------------------
 
   template< typename event_t >
-  using filter_fn_t = std::function< bool( const event_t& ) >;
+  using filter_fn_t = copyable_inline_function< bool( const event_t& ) >;
 
   template< typename event_t, typename access_policy_t >
   class filter_source : public basic_observer< event_t, access_policy_t >        
@@ -77,6 +131,26 @@ namespace streams
         *m_pOutStream << e_;
     }
 
+    void take_event( event_t&& e_ ) final
+    {
+      if ( m_pOutStream && m_filter( e_ ) )
+        *m_pOutStream << std::move( e_ );
+    }
+
+    void on_events( span< event_t > events_ ) final
+    {
+      if ( !m_pOutStream )
+        return;
+
+      detail::scratch_batch< event_t > batch;
+      for( auto& e : events_ )
+      {
+        if( m_filter( e ) )
+          batch.events().push_back( e );
+      }
+      m_pOutStream->push_events( batch.events() );
+    }
+
     void on_done() final { /*! \todo */ }
 
 
@@ -148,6 +222,18 @@ namespace streams
         *m_pOutStream << e_;
     }
 
+    void take_event( event_t&& e_ )
+    {
+      if ( m_pOutStream )
+        *m_pOutStream << std::move( e_ );
+    }
+
+    void on_events( span< event_t > events_ )
+    {
+      if ( m_pOutStream )
+        m_pOutStream->push_events( events_ );
+    }
+
     void on_done() 
     { 
       if( m_onDoneReceived )
@@ -174,6 +260,18 @@ namespace streams
         if( m_parent )
           m_parent->on_event( e_ ); 
       }
+
+      void take_event( event_t&& e_ ) final
+      {
+        if( m_parent )
+          m_parent->take_event( std::move( e_ ) );
+      }
+
+      void on_events( span< event_t > events_ ) final
+      {
+        if( m_parent )
+          m_parent->on_events( events_ );
+      }
       
       void on_done() final 
       { 
@@ -199,7 +297,7 @@ namespace streams
   // -----------------------------------------------------------------------------
 
   template< typename src_event_t, typename dst_event_t >
-  using map_fn_t = std::function< dst_event_t( const src_event_t& ) >;
+  using map_fn_t = copyable_inline_function< dst_event_t( const src_event_t& ) >;
 
   template< typename src_event_t, typename dst_event_t, typename access_policy_t >
   class map_source : public basic_observer< src_event_t, access_policy_t >
@@ -246,6 +344,18 @@ namespace streams
         *m_pOutStream << m_map( e_ );
     }
 
+    void on_events( span< src_event_t > events_ ) final
+    {
+      if ( !m_pOutStream )
+        return;
+
+      detail::scratch_batch< dst_event_t > batch;
+      batch.events().reserve( events_.size() );
+      for( auto& e : events_ )
+        batch.events().push_back( m_map( e ) );
+      m_pOutStream->push_events( batch.events() );
+    }
+
     void on_done() final { /*! \todo */ }
 
 
@@ -256,6 +366,220 @@ namespace streams
   };
 
 
+  // -----------------------------------------------------------------------------
+  // buffer_source
+  // -----------------------------------------------------------------------------
+
+  // Collects events into batches of count_ events, starting a new batch every skip_ events:
+  // skip_ == count_ gives consecutive batches, skip_ < count_ overlapping ones and
+  // skip_ > count_ drops the events in between (see sliding_window for windows that move
+  // on with every event). A batch is emitted as a span into storage that is reused for the
+  // next batch, i.e. it is only valid during the notification. on_done flushes the
+  // incomplete batches, the out stream signals on_done itself when it is destroyed
+  template< typename event_t, typename access_policy_t >
+  class buffer_source : public basic_observer< event_t, access_policy_t >
+  {
+    using base_t = basic_observer< event_t, access_policy_t >;
+    using out_stream_t = basic_stream< span< event_t >, access_policy_t >;
+
+  public:
+
+    template< typename stream_t >
+    buffer_source( stream_t& s_, size_t count_, size_t skip_ )
+      : m_count( count_ > 0 ? count_ : 1 )
+      , m_skip( skip_ > 0 ? skip_ : 1 )
+    {
+      m_events.reserve( m_count );
+      s_.subscribe( *this );
+    }
+
+    buffer_source( const buffer_source& other_ ) { *this = other_; }
+    buffer_source& operator= ( const buffer_source& other_ )
+    {
+      base_t::operator= ( other_ );
+      m_pOutStream = nullptr;
+      m_count = other_.m_count;
+      m_skip = other_.m_skip;
+      m_events.clear();
+      m_events.reserve( m_count );
+      m_gap = 0;
+
+      return *this;
+    }
+
+    buffer_source( buffer_source&& other_ ) { *this = std::move( other_ ); }
+    buffer_source& operator= ( buffer_source&& other_ )
+    {
+      base_t::operator= ( std::move( other_ ) );
+      m_pOutStream = nullptr;
+      m_count = other_.m_count;
+      m_skip = other_.m_skip;
+      m_events = std::move( other_.m_events );
+      m_gap = other_.m_gap;
+
+      return *this;
+    }
+
+    void attach( out_stream_t& s_ )
+    {
+      m_pOutStream = &s_;
+    }
+
+    void on_event( event_t& e_ ) final { push( e_ ); }
+    void take_event( event_t&& e_ ) final { push( std::move( e_ ) ); }
+
+    void on_done() final
+    {
+      if ( !m_pOutStream )
+        return;
+
+      // the batches still open overlap for skip_ < count_
+      while( !m_events.empty() )
+      {
+        *m_pOutStream << span< event_t >( m_events );
+        m_events.erase( m_events.begin(), m_events.begin() + std::min( m_skip, m_events.size() ) );
+      }
+    }
+
+
+  private:
+
+    template< typename arg_t >
+    void push( arg_t&& e_ )
+    {
+      if ( !m_pOutStream )
+        return;
+
+      if( m_gap > 0 )
+      {
+        --m_gap;
+        return;
+      }
+
+      m_events.push_back( std::forward< arg_t >( e_ ) );
+      if( m_events.size() < m_count )
+        return;
+
+      *m_pOutStream << span< event_t >( m_events );
+
+      if( m_skip >= m_count )
+      {
+        m_events.clear();
+        m_gap = m_skip - m_count;
+      }
+      else
+      {
+        // the next batch started skip_ events into this one
+        m_events.erase( m_events.begin(), m_events.begin() + m_skip );
+      }
+    }
+
+
+    size_t m_count;
+    size_t m_skip;
+    out_stream_t* m_pOutStream = nullptr;
+    std::vector< event_t > m_events;  // of the oldest open batch onwards
+    size_t m_gap = 0;                 // events to drop before the next batch starts
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // sliding_window_source
+  // -----------------------------------------------------------------------------
+
+  // Sliding window over the latest count_ events, emitted as a span for every event once
+  // count_ events have arrived - i.e. count_ times the downstream work of buffer( s, count_ ).
+  // The emitted windows are the full batches of buffer( s, count_, 1 ), but the events are
+  // kept in a buffer of twice the window size, so the window is always contiguous and only
+  // every count_-th event moves the window back to the front of the buffer. on_done only
+  // flushes a window that never got full: once one was full, every event ended a window, and
+  // unlike buffer( s, count_, 1 ) no shrinking windows follow
+  template< typename event_t, typename access_policy_t >
+  class sliding_window_source : public basic_observer< event_t, access_policy_t >
+  {
+    using base_t = basic_observer< event_t, access_policy_t >;
+    using out_stream_t = basic_stream< span< event_t >, access_policy_t >;
+
+  public:
+
+    template< typename stream_t >
+    sliding_window_source( stream_t& s_, size_t count_ )
+      : m_count( count_ > 0 ? count_ : 1 )
+    {
+      m_events.reserve( 2 * m_count );
+      s_.subscribe( *this );
+    }
+
+    sliding_window_source( const sliding_window_source& other_ ) { *this = other_; }
+    sliding_window_source& operator= ( const sliding_window_source& other_ )
+    {
+      base_t::operator= ( other_ );
+      m_pOutStream = nullptr;
+      m_count = other_.m_count;
+      m_events.clear();
+      m_events.reserve( 2 * m_count );
+      m_emitted = false;
+
+      return *this;
+    }
+
+    sliding_window_source( sliding_window_source&& other_ ) { *this = std::move( other_ ); }
+    sliding_window_source& operator= ( sliding_window_source&& other_ )
+    {
+      base_t::operator= ( std::move( other_ ) );
+      m_pOutStream = nullptr;
+      m_count = other_.m_count;
+      m_events = std::move( other_.m_events );
+      m_emitted = other_.m_emitted;
+
+      return *this;
+    }
+
+    void attach( out_stream_t& s_ )
+    {
+      m_pOutStream = &s_;
+    }
+
+    void on_event( event_t& e_ ) final { push( e_ ); }
+    void take_event( event_t&& e_ ) final { push( std::move( e_ ) ); }
+
+    void on_done() final
+    {
+      if ( !m_pOutStream )
+        return;
+
+      if( !m_emitted && !m_events.empty() )
+        *m_pOutStream << span< event_t >( m_events );
+    }
+
+
+  private:
+
+    template< typename arg_t >
+    void push( arg_t&& e_ )
+    {
+      if ( !m_pOutStream )
+        return;
+
+      if( m_events.size() == 2 * m_count )
+        m_events.erase( m_events.begin(), m_events.begin() + m_count );
+
+      m_events.push_back( std::forward< arg_t >( e_ ) );
+      if( m_events.size() < m_count )
+        return;
+
+      m_emitted = true;
+      *m_pOutStream << span< event_t >( m_events.data() + m_events.size() - m_count, m_count );
+    }
+
+
+    size_t m_count;
+    out_stream_t* m_pOutStream = nullptr;
+    std::vector< event_t > m_events;
+    bool m_emitted = false;
+  };
+
+
   // -----------------------------------------------------------------------------
   // operators
   // -----------------------------------------------------------------------------
@@ -313,28 +637,88 @@ namespace streams
   }
 
 
-  template< typename src_stream_t, typename dst_event_t >
-  basic_stream< dst_event_t, typename src_stream_t::access_policy > map( 
+  // the type of the mapped events is deduced from the result of the map function
+  template< typename src_stream_t, typename fn_t >
+  using map_result_t = std::decay_t<
+    decltype( std::declval< fn_t& >()( std::declval< const typename src_stream_t::event_type& >() ) ) >;
+
+  template< typename src_stream_t, typename fn_t >
+  basic_stream< map_result_t< src_stream_t, fn_t >, typename src_stream_t::access_policy > map( 
     src_stream_t& s_, 
-    map_fn_t< typename src_stream_t::event_type, dst_event_t > f_ 
+    fn_t&& f_ 
   )
   {
     using src_event_t = typename src_stream_t::event_type;
+    using dst_event_t = map_result_t< src_stream_t, fn_t >;
     using access_policy_t = typename src_stream_t::access_policy;
    
     return std::move( basic_stream< dst_event_t, access_policy_t >( 
-      map_source< src_event_t, dst_event_t, access_policy_t >( s_, f_ ) ) 
+      map_source< src_event_t, dst_event_t, access_policy_t >( s_, std::forward< fn_t >( f_ ) ) ) 
     );
   }
 
-  template< typename src_stream_t, typename dst_event_t >
-  basic_stream< dst_event_t, typename src_stream_t::access_policy > operator>>( 
+  template< typename src_stream_t, typename fn_t >
+  basic_stream< map_result_t< src_stream_t, fn_t >, typename src_stream_t::access_policy > operator>>( 
     src_stream_t& s_, 
-    map_fn_t< typename src_stream_t::event_type, dst_event_t > f_ 
+    fn_t&& f_ 
   )
   {
-   return std::move( map( s_, f_ ) );
+   return std::move( map( s_, std::forward< fn_t >( f_ ) ) );
   }
-  
+
+
+
+  template< typename stream_t >
+  basic_stream< span< typename stream_t::event_type >, typename stream_t::access_policy >
+  buffer(
+    stream_t& s_,
+    size_t count_,
+    size_t skip_
+  )
+  {
+    using event_t = typename stream_t::event_type;
+    using access_policy_t = typename stream_t::access_policy;
+
+    return std::move( basic_stream< span< event_t >, access_policy_t >(
+      buffer_source< event_t, access_policy_t >( s_, count_, skip_ )
+    ));
+  }
+
+  template< typename stream_t >
+  basic_stream< span< typename stream_t::event_type >, typename stream_t::access_policy >
+  buffer(
+    stream_t& s_,
+    size_t count_
+  )
+  {
+    return std::move( buffer( s_, count_, count_ ) );
+  }
+
+  // non-overlapping windows of count_ events, the same as buffer( s_, count_ )
+  template< typename stream_t >
+  basic_stream< span< typename stream_t::event_type >, typename stream_t::access_policy >
+  window(
+    stream_t& s_,
+    size_t count_
+  )
+  {
+    return std::move( buffer( s_, count_, count_ ) );
+  }
+
+  template< typename stream_t >
+  basic_stream< span< typename stream_t::event_type >, typename stream_t::access_policy >
+  sliding_window(
+    stream_t& s_,
+    size_t count_
+  )
+  {
+    using event_t = typename stream_t::event_type;
+    using access_policy_t = typename stream_t::access_policy;
+
+    return std::move( basic_stream< span< event_t >, access_policy_t >(
+      sliding_window_source< event_t, access_policy_t >( s_, count_ )
+    ));
+  }
+
 }
 }
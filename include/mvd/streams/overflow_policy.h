@@ -0,0 +1,235 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "inline_function.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // overflow_statistics
+  // -----------------------------------------------------------------------------
+
+  // counts what happened to events that didn't fit into the queue of an async stream.
+  // The counters are updated with relaxed atomics, copying takes a snapshot
+  class overflow_statistics
+  {
+  public:
+
+    overflow_statistics() = default;
+
+    overflow_statistics( const overflow_statistics& other_ ) { *this = other_; }
+    overflow_statistics& operator= ( const overflow_statistics& other_ )
+    {
+      m_dropped.store( other_.dropped(), std::memory_order_relaxed );
+      m_rejected.store( other_.rejected(), std::memory_order_relaxed );
+      m_grown.store( other_.grown(), std::memory_order_relaxed );
+      return *this;
+    }
+
+    // events discarded by drop_newest, drop_oldest, a timed out block, or grow beyond the limit
+    size_t dropped() const { return m_dropped.load( std::memory_order_relaxed ); }
+
+    // events handed to the reject callback
+    size_t rejected() const { return m_rejected.load( std::memory_order_relaxed ); }
+
+    // number of times the queue was enlarged
+    size_t grown() const { return m_grown.load( std::memory_order_relaxed ); }
+
+    void count_dropped() { m_dropped.fetch_add( 1, std::memory_order_relaxed ); }
+    void count_rejected() { m_rejected.fetch_add( 1, std::memory_order_relaxed ); }
+    void count_grown() { m_grown.fetch_add( 1, std::memory_order_relaxed ); }
+
+  private:
+
+    std::atomic< size_t > m_dropped{ 0 };
+    std::atomic< size_t > m_rejected{ 0 };
+    std::atomic< size_t > m_grown{ 0 };
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // overflow_policy
+  // -----------------------------------------------------------------------------
+
+  enum class overflow_action
+  {
+    drop_newest,  // discard the event that didn't fit
+    drop_oldest,  // discard the oldest queued event to make room
+    block,        // retry until there is room or the timeout expires, then drop
+    grow,         // enlarge the queue up to a maximum capacity, then drop
+    reject        // hand the event to a callback
+  };
+
+
+  template< typename event_t >
+  class overflow_policy;
+
+  // drop_oldest consumes from the queue and grow reallocates it, both on the pushing thread.
+  // That is only safe for queues a consumer thread doesn't access concurrently with push, so
+  // queues opt in by specializing this trait - default_queue does, spsc_queue / mpsc_queue
+  // don't
+  template< typename queue_t >
+  struct supports_exclusive_overflow : std::false_type {};
+
+  // an overflow_policy that requires supports_exclusive_overflow of the queue. Async streams
+  // and observers static_assert this when it is set
+  template< typename event_t >
+  class exclusive_overflow_policy
+  {
+    friend class overflow_policy< event_t >;
+
+  public:
+
+    const overflow_policy< event_t >& policy() const { return m_policy; }
+
+  private:
+
+    exclusive_overflow_policy( overflow_policy< event_t > policy_ ) : m_policy( std::move( policy_ ) ) {}
+
+    overflow_policy< event_t > m_policy;
+  };
+
+
+  // Selects what an async stream or observer does with an event its queue has no room for.
+  // drop_oldest and grow return an exclusive_overflow_policy, see supports_exclusive_overflow.
+  // grow also requires the queue to provide bool grow( size_t maxCapacity ) (default_queue
+  // does), with other queues it behaves like drop_newest
+  template< typename event_t >
+  class overflow_policy
+  {
+  public:
+
+    using reject_fn_t = copyable_inline_function< void( const event_t& ) >;
+
+    static overflow_policy drop_newest() { return overflow_policy( overflow_action::drop_newest ); }
+    static exclusive_overflow_policy< event_t > drop_oldest()
+    {
+      return exclusive_overflow_policy< event_t >( overflow_policy( overflow_action::drop_oldest ) );
+    }
+
+    static overflow_policy block( std::chrono::nanoseconds timeout_ )
+    {
+      auto p = overflow_policy( overflow_action::block );
+      p.m_timeout = timeout_;
+      return p;
+    }
+
+    static exclusive_overflow_policy< event_t > grow( size_t maxCapacity_ )
+    {
+      auto p = overflow_policy( overflow_action::grow );
+      p.m_maxCapacity = maxCapacity_;
+      return exclusive_overflow_policy< event_t >( std::move( p ) );
+    }
+
+    static overflow_policy reject( reject_fn_t onReject_ )
+    {
+      auto p = overflow_policy( overflow_action::reject );
+      p.m_onReject = std::move( onReject_ );
+      return p;
+    }
+
+    overflow_action action() const { return m_action; }
+
+    // pushes e_ into queue_, applying the policy if it's full. Queues must leave e_ untouched
+    // when push fails
+    template< typename queue_t, typename arg_t >
+    void push( queue_t& queue_, arg_t&& e_, overflow_statistics& stats_ ) const
+    {
+      if( queue_.push( std::forward< arg_t >( e_ ) ) )
+        return;
+
+      switch( m_action )
+      {
+        case overflow_action::drop_newest:
+          stats_.count_dropped();
+          break;
+
+        case overflow_action::drop_oldest:
+          if( queue_.consume_one( []( event_t& ) {} ) )
+            stats_.count_dropped();
+          if( !queue_.push( std::forward< arg_t >( e_ ) ) )
+            stats_.count_dropped();
+          break;
+
+        case overflow_action::block:
+        {
+          auto deadline = std::chrono::steady_clock::now() + m_timeout;
+          while( !queue_.push( std::forward< arg_t >( e_ ) ) )
+          {
+            if( std::chrono::steady_clock::now() >= deadline )
+            {
+              stats_.count_dropped();
+              break;
+            }
+            std::this_thread::yield();
+          }
+          break;
+        }
+
+        case overflow_action::grow:
+          if( grow_queue( queue_, 0 ) )
+          {
+            stats_.count_grown();
+            if( queue_.push( std::forward< arg_t >( e_ ) ) )
+              break;
+          }
+          stats_.count_dropped();
+          break;
+
+        case overflow_action::reject:
+          stats_.count_rejected();
+          if( m_onReject )
+            m_onReject( e_ );
+          break;
+      }
+    }
+
+  private:
+
+    overflow_policy( overflow_action action_ ) : m_action( action_ ) {}
+
+    template< typename queue_t >
+    auto grow_queue( queue_t& queue_, int ) const -> decltype( queue_.grow( size_t() ) )
+    {
+      return queue_.grow( m_maxCapacity );
+    }
+
+    template< typename queue_t >
+    bool grow_queue( queue_t&, long ) const { return false; }
+
+
+    overflow_action m_action;
+    std::chrono::nanoseconds m_timeout{ 0 };
+    size_t m_maxCapacity = 0;
+    reject_fn_t m_onReject;
+  };
+
+}
+}
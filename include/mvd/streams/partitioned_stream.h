@@ -0,0 +1,167 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "basic_async_stream.h"
+#include "basic_stream.h"
+#include "dispatcher.h"
+#include "inline_function.h"
+#include "mpsc_queue.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // partitioned_stream
+  // -----------------------------------------------------------------------------
+
+  // Stream that spreads its events over shardCount_ shards by a user supplied key, e.g. an
+  // instrument id. Every shard is an async stream with its own queue and dispatcher thread,
+  // so events with the same key are dispatched in the order they were pushed, while events
+  // with different keys may be dispatched in parallel.
+  //
+  // The observers of a partitioned_stream are notified from all shard threads concurrently,
+  // hence
+  // - they have to cope with concurrent on_event calls (for events with different keys)
+  // - the access policy has to allow concurrent dispatching, i.e. copy_on_write or
+  //   shared_locked. With locked the shards would take turns
+  // Pushing is thread-safe as long as collection_t allows multiple producers. Events still
+  // queued when the stream is destroyed are dispatched before it goes.
+  template<
+    typename event_t,
+    typename access_policy_t = access_policy::copy_on_write,
+    template< typename > class collection_t = mpsc_queue
+  >
+  class partitioned_stream : public basic_stream< event_t, access_policy_t >
+  {
+    using base_t = basic_stream< event_t, access_policy_t >;
+    using shard_stream_t = basic_async_stream< event_t, access_policy::none, collection_t >;
+
+  public:
+
+    // returns the partition key of an event. Keys are hashed, so they needn't be
+    // evenly distributed
+    using key_fn_t = inline_function< size_t( const event_t& ) >;
+
+    partitioned_stream( size_t shardCount_, size_t queueSize_, key_fn_t keyFn_ )
+      : m_keyFn( std::move( keyFn_ ) )
+    {
+      for( size_t i = 0; i < std::max< size_t >( shardCount_, 1 ); ++i )
+        m_shards.push_back( std::make_unique< shard >( *this, queueSize_ ) );
+    }
+
+    ~partitioned_stream() override
+    {
+      for( auto& s : m_shards )
+      {
+        s->worker.stop();
+        s->stream.dispatch_events();
+      }
+    }
+
+    // the shards are bound to this stream
+    partitioned_stream( const partitioned_stream& ) = delete;
+    partitioned_stream& operator= ( const partitioned_stream& ) = delete;
+
+    partitioned_stream& operator << ( event_t e_ ) final
+    {
+      shard_for( e_ ) << std::move( e_ );
+      return *this;
+    }
+
+    partitioned_stream& push_events( span< event_t > events_ ) final
+    {
+      for( auto& e : events_ )
+        shard_for( e ) << e;
+      return *this;
+    }
+
+    size_t shard_count() const { return m_shards.size(); }
+
+    // see basic_async_stream::set_overflow_policy, applies to every shard
+    void set_overflow_policy( const overflow_policy< event_t >& policy_ )
+    {
+      for( auto& s : m_shards )
+        s->stream.set_overflow_policy( policy_ );
+    }
+
+    void set_overflow_policy( const exclusive_overflow_policy< event_t >& policy_ )
+    {
+      for( auto& s : m_shards )
+        s->stream.set_overflow_policy( policy_ );
+    }
+
+    const overflow_statistics& get_overflow_statistics( size_t shard_ ) const
+    {
+      return m_shards[ shard_ ]->stream.get_overflow_statistics();
+    }
+
+  private:
+
+    // passes the events of a shard on to the observers of the partitioned_stream
+    class shard_observer : public basic_observer< event_t, access_policy::none >
+    {
+    public:
+
+      explicit shard_observer( partitioned_stream& owner_ ) : m_owner( owner_ ) {}
+
+      void on_event( event_t& e_ ) final { m_owner.dispatch( e_ ); }
+      void take_event( event_t&& e_ ) final { m_owner.dispatch( e_ ); }
+      void on_done() final {}
+
+    private:
+
+      partitioned_stream& m_owner;
+    };
+
+    struct shard
+    {
+      shard( partitioned_stream& owner_, size_t queueSize_ )
+        : stream( queueSize_ )
+        , observer( owner_ )
+      {
+        stream.subscribe( observer );
+        stream.set_executor( &worker );
+      }
+
+      dispatcher worker;  // destroyed last
+      shard_stream_t stream;
+      shard_observer observer;
+    };
+
+    shard_stream_t& shard_for( const event_t& e_ )
+    {
+      // mix the key so that sequential keys don't all end up in the same few shards
+      auto h = static_cast< std::uint64_t >( m_keyFn( e_ ) ) * 0x9E3779B97F4A7C15ull;
+      return m_shards[ static_cast< size_t >( h >> 32 ) % m_shards.size() ]->stream;
+    }
+
+
+    key_fn_t m_keyFn;
+    std::vector< std::unique_ptr< shard > > m_shards;
+  };
+
+}
+}
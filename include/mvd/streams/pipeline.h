@@ -0,0 +1,363 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "basic_stream.h"
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+namespace mvd
+{
+namespace streams
+{
+  // ---------------------------------------------------------------------------
+  // fused stages
+  // ---------------------------------------------------------------------------
+  //
+  // A pipeline like  s | filter( f ) | map( g ) | sink( h )  is fused into a single
+  // callable  fused_filter< f, fused_map< g, fused_sink< h > > >  whose type is
+  // fully known at compile time, so the whole chain can be inlined into the one
+  // observer that is subscribed to s. No intermediate streams are created.
+
+  struct pipeline_end {};
+
+  template< typename fn_t, typename next_t >
+  class fused_filter
+  {
+  public:
+
+    fused_filter( fn_t fn_, next_t next_ )
+      : m_fn( std::move( fn_ ) )
+      , m_next( std::move( next_ ) )
+    {}
+
+    template< typename e_t >
+    void operator()( e_t& e_ )
+    {
+      if( m_fn( e_ ) )
+        m_next( e_ );
+    }
+
+    void done() { m_next.done(); }
+
+  private:
+
+    fn_t m_fn;
+    next_t m_next;
+  };
+
+
+  template< typename fn_t, typename next_t >
+  class fused_map
+  {
+  public:
+
+    fused_map( fn_t fn_, next_t next_ )
+      : m_fn( std::move( fn_ ) )
+      , m_next( std::move( next_ ) )
+    {}
+
+    template< typename e_t >
+    void operator()( e_t& e_ )
+    {
+      auto mapped = m_fn( e_ );
+      m_next( mapped );
+    }
+
+    void done() { m_next.done(); }
+
+  private:
+
+    fn_t m_fn;
+    next_t m_next;
+  };
+
+
+  template< typename on_event_fn_t, typename on_done_fn_t >
+  class fused_sink
+  {
+  public:
+
+    fused_sink( on_event_fn_t onEvent_, on_done_fn_t onDone_ )
+      : m_onEvent( std::move( onEvent_ ) )
+      , m_onDone( std::move( onDone_ ) )
+    {}
+
+    template< typename e_t >
+    void operator()( e_t& e_ ) { m_onEvent( e_ ); }
+
+    void done() { m_onDone(); }
+
+  private:
+
+    on_event_fn_t m_onEvent;
+    on_done_fn_t m_onDone;
+  };
+
+
+  // ---------------------------------------------------------------------------
+  // pipeline stages
+  // ---------------------------------------------------------------------------
+
+  template< typename fn_t >
+  struct filter_stage
+  {
+    template< typename next_t >
+    fused_filter< fn_t, next_t > fuse( next_t next_ ) const
+    {
+      return fused_filter< fn_t, next_t >( fn, std::move( next_ ) );
+    }
+
+    fn_t fn;
+  };
+
+
+  template< typename fn_t >
+  struct map_stage
+  {
+    template< typename next_t >
+    fused_map< fn_t, next_t > fuse( next_t next_ ) const
+    {
+      return fused_map< fn_t, next_t >( fn, std::move( next_ ) );
+    }
+
+    fn_t fn;
+  };
+
+
+  struct no_op_on_done
+  {
+    void operator()() const {}
+  };
+
+  template< typename on_event_fn_t, typename on_done_fn_t >
+  struct sink_stage
+  {
+    fused_sink< on_event_fn_t, on_done_fn_t > fuse( pipeline_end ) const
+    {
+      return fused_sink< on_event_fn_t, on_done_fn_t >( onEvent, onDone );
+    }
+
+    on_event_fn_t onEvent;
+    on_done_fn_t onDone;
+  };
+
+
+  template< typename stage_t >
+  struct is_sink_stage : std::false_type {};
+
+  template< typename on_event_fn_t, typename on_done_fn_t >
+  struct is_sink_stage< sink_stage< on_event_fn_t, on_done_fn_t > > : std::true_type {};
+
+
+  // ---------------------------------------------------------------------------
+  // pipeline
+  // ---------------------------------------------------------------------------
+
+  template< typename... stages_t >
+  class pipeline
+  {
+    template< size_t index_, typename dummy_t = void >
+    struct fuser
+    {
+      template< typename next_t >
+      static auto fuse( const std::tuple< stages_t... >& stages_, next_t next_ )
+      {
+        return fuser< index_ - 1 >::fuse( stages_, std::get< index_ - 1 >( stages_ ).fuse( std::move( next_ ) ) );
+      }
+    };
+
+    template< typename dummy_t >
+    struct fuser< 0, dummy_t >
+    {
+      template< typename next_t >
+      static next_t fuse( const std::tuple< stages_t... >&, next_t next_ ) { return next_; }
+    };
+
+  public:
+
+    static constexpr size_t stage_count = sizeof...( stages_t );
+
+    using last_stage_t = typename std::tuple_element< stage_count - 1, std::tuple< stages_t... > >::type;
+    static constexpr bool is_complete = is_sink_stage< last_stage_t >::value;
+
+    explicit pipeline( std::tuple< stages_t... > stages_ )
+      : m_stages( std::move( stages_ ) )
+    {}
+
+    const std::tuple< stages_t... >& stages() const { return m_stages; }
+
+    // only available for complete pipelines, i.e. pipelines that end in a sink
+    auto fuse() const { return fuser< stage_count >::fuse( m_stages, pipeline_end{} ); }
+
+  private:
+
+    std::tuple< stages_t... > m_stages;
+  };
+
+
+  // ---------------------------------------------------------------------------
+  // pipeline_observer
+  // ---------------------------------------------------------------------------
+  //
+  // The observer returned by  s | ... | sink( h )  owns the subscription to s: the
+  // pipeline only runs as long as the returned object is alive. Discarding it, as in
+  //
+  //   s | filter( f ) | sink( h );          // unsubscribed again right away
+  //
+  // silently does nothing, so keep it in a variable or member for as long as events
+  // should flow. From C++17 on the class is [[nodiscard]] and compilers warn about it.
+
+#if __cplusplus >= 201703L
+#define MVD_STREAMS_PIPELINE_NODISCARD [[nodiscard]]
+#else
+#define MVD_STREAMS_PIPELINE_NODISCARD
+#endif
+
+  template< typename event_t, typename access_policy_t, typename fn_t >
+  class MVD_STREAMS_PIPELINE_NODISCARD pipeline_observer : public basic_observer< event_t, access_policy_t >
+  {
+  public:
+
+    template< typename stream_t >
+    pipeline_observer( stream_t& s_, fn_t fn_ )
+      : m_fn( std::move( fn_ ) )
+    {
+      s_.subscribe( *this );
+    }
+
+    void on_event( event_t& e_ ) final { m_fn( e_ ); }
+
+    void on_events( span< event_t > events_ ) final
+    {
+      for( auto& e : events_ )
+        m_fn( e );
+    }
+
+    void on_done() final { m_fn.done(); }
+
+  private:
+
+    fn_t m_fn;
+  };
+
+
+  // ---------------------------------------------------------------------------
+  // bound_pipeline
+  // ---------------------------------------------------------------------------
+
+  // a stream with an incomplete pipeline attached to it, waiting for more stages
+  template< typename stream_t, typename... stages_t >
+  class bound_pipeline
+  {
+  public:
+
+    using stream_type = stream_t;
+    using pipeline_type = pipeline< stages_t... >;
+
+    bound_pipeline( stream_t& s_, pipeline_type p_ )
+      : m_stream( s_ )
+      , m_pipeline( std::move( p_ ) )
+    {}
+
+    stream_t& stream() const { return m_stream; }
+    const pipeline_type& get_pipeline() const { return m_pipeline; }
+
+  private:
+
+    stream_t& m_stream;
+    pipeline_type m_pipeline;
+  };
+
+
+  template< typename stream_t, typename... stages_t >
+  auto bind_pipeline( stream_t& s_, pipeline< stages_t... > p_, std::true_type /*complete*/ )
+  {
+    using event_t = typename stream_t::event_type;
+    using access_policy_t = typename stream_t::access_policy;
+    using fn_t = decltype( p_.fuse() );
+
+    return pipeline_observer< event_t, access_policy_t, fn_t >( s_, p_.fuse() );
+  }
+
+  template< typename stream_t, typename... stages_t >
+  auto bind_pipeline( stream_t& s_, pipeline< stages_t... > p_, std::false_type /*complete*/ )
+  {
+    return bound_pipeline< stream_t, stages_t... >( s_, std::move( p_ ) );
+  }
+
+
+  // ---------------------------------------------------------------------------
+  // operators
+  // ---------------------------------------------------------------------------
+
+  template< typename fn_t >
+  pipeline< filter_stage< fn_t > > filter( fn_t fn_ )
+  {
+    return pipeline< filter_stage< fn_t > >( std::make_tuple( filter_stage< fn_t >{ std::move( fn_ ) } ) );
+  }
+
+  template< typename fn_t >
+  pipeline< map_stage< fn_t > > map( fn_t fn_ )
+  {
+    return pipeline< map_stage< fn_t > >( std::make_tuple( map_stage< fn_t >{ std::move( fn_ ) } ) );
+  }
+
+  template< typename on_event_fn_t, typename on_done_fn_t = no_op_on_done >
+  pipeline< sink_stage< on_event_fn_t, on_done_fn_t > > sink(
+    on_event_fn_t onEvent_,
+    on_done_fn_t onDone_ = on_done_fn_t()
+  )
+  {
+    using stage_t = sink_stage< on_event_fn_t, on_done_fn_t >;
+    return pipeline< stage_t >( std::make_tuple( stage_t{ std::move( onEvent_ ), std::move( onDone_ ) } ) );
+  }
+
+
+  // concatenate two pipelines
+  template< typename... lhs_stages_t, typename... rhs_stages_t >
+  pipeline< lhs_stages_t..., rhs_stages_t... > operator| (
+    const pipeline< lhs_stages_t... >& lhs_,
+    const pipeline< rhs_stages_t... >& rhs_
+  )
+  {
+    static_assert( !pipeline< lhs_stages_t... >::is_complete, "can't append stages after a sink" );
+    return pipeline< lhs_stages_t..., rhs_stages_t... >( std::tuple_cat( lhs_.stages(), rhs_.stages() ) );
+  }
+
+  // attach a pipeline to a stream - returns the subscribed observer if the pipeline
+  // is complete, a bound_pipeline waiting for more stages otherwise. The observer
+  // must be kept alive, destroying it unsubscribes the pipeline (see pipeline_observer)
+  template< typename stream_t, typename... stages_t, typename = typename stream_t::event_type >
+  auto operator| ( stream_t& s_, const pipeline< stages_t... >& p_ )
+  {
+    return bind_pipeline( s_, p_, std::integral_constant< bool, pipeline< stages_t... >::is_complete >() );
+  }
+
+  template< typename stream_t, typename... bound_stages_t, typename... stages_t >
+  auto operator| ( const bound_pipeline< stream_t, bound_stages_t... >& b_, const pipeline< stages_t... >& p_ )
+  {
+    return b_.stream() | ( b_.get_pipeline() | p_ );
+  }
+
+}
+}
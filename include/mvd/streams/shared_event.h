@@ -0,0 +1,164 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "access_policy.h"
+
+#include <atomic>
+#include <utility>
+
+namespace mvd
+{
+namespace streams
+{
+
+  namespace detail
+  {
+    // atomic unless the access policy says the event never leaves its thread
+    template< typename access_policy_t >
+    class shared_event_refcount
+    {
+    public:
+
+      void increment() { m_count.fetch_add( 1, std::memory_order_relaxed ); }
+
+      // returns true if this was the last reference
+      bool decrement() { return m_count.fetch_sub( 1, std::memory_order_acq_rel ) == 1; }
+
+      unsigned get() const { return m_count.load( std::memory_order_relaxed ); }
+
+    private:
+
+      std::atomic< unsigned > m_count{ 1 };
+    };
+
+    class plain_refcount
+    {
+    public:
+
+      void increment() { ++m_count; }
+      bool decrement() { return --m_count == 0; }
+      unsigned get() const { return m_count; }
+
+    private:
+
+      unsigned m_count = 1;
+    };
+
+    template<>
+    class shared_event_refcount< access_policy::none > : public plain_refcount {};
+
+    template<>
+    class shared_event_refcount< access_policy::thread_confined > : public plain_refcount {};
+  }
+
+
+  // -----------------------------------------------------------------------------
+  // shared_event
+  // -----------------------------------------------------------------------------
+
+  // Immutable, reference counted event. The event is materialized once in a block that
+  // also holds the reference count, handles only carry a pointer to it - so fanning one
+  // event out to many async observers queues a pointer per observer instead of a copy of
+  // the event.
+  //
+  // The reference count is atomic by default. It is independent of the policy of the stream
+  // carrying the event: async observers with spsc_queue / mpsc_queue use access_policy::none
+  // themselves, yet copy and destroy handles on different threads. Events that never leave
+  // their thread can opt into a plain integer count with access_policy::none or
+  // thread_confined.
+  template< typename T, typename access_policy_t = access_policy::locked >
+  class shared_event
+  {
+    struct block
+    {
+      template< typename... args_t >
+      explicit block( args_t&&... args_ ) : value( std::forward< args_t >( args_ )... ) {}
+
+      detail::shared_event_refcount< access_policy_t > refCount;
+      const T value;
+    };
+
+  public:
+
+    using value_type = T;
+
+    shared_event() = default;
+    ~shared_event() { reset(); }
+
+    shared_event( const shared_event& other_ ) { *this = other_; }
+    shared_event& operator= ( const shared_event& other_ )
+    {
+      if( other_.m_block )
+        other_.m_block->refCount.increment();
+      reset();
+      m_block = other_.m_block;
+      return *this;
+    }
+
+    shared_event( shared_event&& other_ ) noexcept : m_block( other_.m_block ) { other_.m_block = nullptr; }
+    shared_event& operator= ( shared_event&& other_ ) noexcept
+    {
+      if( this == &other_ )
+        return *this;
+
+      reset();
+      m_block = other_.m_block;
+      other_.m_block = nullptr;
+      return *this;
+    }
+
+    // constructs the event in a new block
+    template< typename... args_t >
+    static shared_event make( args_t&&... args_ )
+    {
+      return shared_event( new block( std::forward< args_t >( args_ )... ) );
+    }
+
+    void reset()
+    {
+      if( m_block && m_block->refCount.decrement() )
+        delete m_block;
+      m_block = nullptr;
+    }
+
+    const T* get() const { return m_block ? &m_block->value : nullptr; }
+    const T& operator* () const { return m_block->value; }
+    const T* operator-> () const { return &m_block->value; }
+
+    explicit operator bool() const { return m_block != nullptr; }
+
+    unsigned use_count() const { return m_block ? m_block->refCount.get() : 0; }
+
+  private:
+
+    explicit shared_event( block* block_ ) : m_block( block_ ) {}
+
+    block* m_block = nullptr;
+  };
+
+
+  template< typename T, typename access_policy_t = access_policy::locked, typename... args_t >
+  shared_event< T, access_policy_t > make_shared_event( args_t&&... args_ )
+  {
+    return shared_event< T, access_policy_t >::make( std::forward< args_t >( args_ )... );
+  }
+
+}
+}
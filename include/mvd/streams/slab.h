@@ -0,0 +1,165 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // slab
+  // -----------------------------------------------------------------------------
+
+  // Allocates objects in fixed size chunks. Objects never move once created, freed slots
+  // are kept in a free list and reused by subsequent emplace calls, so both emplace and
+  // erase are O(1) and only every chunk_size_-th emplace allocates. Every slot counts the
+  // objects erased from it, so a stale reference can be told apart from a new object that
+  // reuses the slot (see generation and contains).
+  // Not thread-safe.
+  template< typename T, size_t chunk_size_ = 64 >
+  class slab
+  {
+    struct slot
+    {
+      typename std::aligned_storage< sizeof( T ), alignof( T ) >::type storage;  // must be first
+      slot* nextFree = nullptr;
+      size_t generation = 0;
+      bool occupied = false;
+
+      T& object() { return *reinterpret_cast< T* >( &storage ); }
+    };
+
+    struct chunk
+    {
+      slot slots[ chunk_size_ ];
+    };
+
+  public:
+
+    slab() = default;
+    ~slab() { clear(); }
+
+    slab( const slab& ) = delete;
+    slab& operator= ( const slab& ) = delete;
+
+    slab( slab&& other_ ) { *this = std::move( other_ ); }
+    slab& operator= ( slab&& other_ )
+    {
+      if( this == &other_ )
+        return *this;
+
+      clear();
+      m_chunks = std::move( other_.m_chunks );
+      m_freeList = other_.m_freeList;
+      m_size = other_.m_size;
+
+      other_.m_chunks.clear();
+      other_.m_freeList = nullptr;
+      other_.m_size = 0;
+      return *this;
+    }
+
+    template< typename... args_t >
+    T& emplace( args_t&&... args_ )
+    {
+      if( !m_freeList )
+        add_chunk();
+
+      slot* s = m_freeList;
+      new ( &s->storage ) T( std::forward< args_t >( args_ )... );
+      m_freeList = s->nextFree;
+      s->occupied = true;
+      ++m_size;
+      return s->object();
+    }
+
+    // o_ must have been created by this slab. Erasing an already erased object has no effect
+    // and returns false
+    bool erase( T& o_ )
+    {
+      slot* s = reinterpret_cast< slot* >( &o_ );
+      if( !s->occupied )
+        return false;
+
+      s->object().~T();
+      s->occupied = false;
+      ++s->generation;
+      s->nextFree = m_freeList;
+      m_freeList = s;
+      --m_size;
+      return true;
+    }
+
+    // the generation of the slot of o_, which changes whenever o_ is erased
+    size_t generation( const T& o_ ) const { return slot_of( o_ ).generation; }
+
+    // whether o_, created in the given generation of its slot, has not been erased yet. o_
+    // may refer to an erased object, as long as this slab is still alive
+    bool contains( const T& o_, size_t generation_ ) const
+    {
+      const slot& s = slot_of( o_ );
+      return s.occupied && s.generation == generation_;
+    }
+
+    void clear()
+    {
+      for( auto& c : m_chunks )
+      {
+        for( auto& s : c->slots )
+        {
+          if( s.occupied )
+            erase( s.object() );
+        }
+      }
+    }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_chunks.size() * chunk_size_; }
+
+  private:
+
+    static const slot& slot_of( const T& o_ ) { return *reinterpret_cast< const slot* >( &o_ ); }
+
+    void add_chunk()
+    {
+      m_chunks.push_back( std::make_unique< chunk >() );
+
+      auto& slots = m_chunks.back()->slots;
+      for( size_t i = chunk_size_; i-- > 0; )
+      {
+        slots[i].nextFree = m_freeList;
+        m_freeList = &slots[i];
+      }
+    }
+
+
+    std::vector< std::unique_ptr< chunk > > m_chunks;
+    slot* m_freeList = nullptr;
+    size_t m_size = 0;
+  };
+
+}
+}
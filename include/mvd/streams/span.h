@@ -0,0 +1,90 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // span
+  // -----------------------------------------------------------------------------
+
+  // non-owning view of a contiguous range of events (a minimal stand-in for std::span,
+  // which is not available in C++14)
+  template< typename T >
+  class span
+  {
+    template< typename container_t >
+    using enable_if_container_t = std::enable_if_t<
+      std::is_convertible< decltype( std::declval< container_t& >().data() ), T* >::value
+    >;
+
+  public:
+
+    using element_type = T;
+    using value_type = std::remove_cv_t< T >;
+    using iterator = T*;
+
+    span() = default;
+
+    span( T* data_, size_t size_ )
+      : m_data( data_ )
+      , m_size( size_ )
+    {}
+
+    span( T* first_, T* last_ )
+      : m_data( first_ )
+      , m_size( static_cast< size_t >( last_ - first_ ) )
+    {}
+
+    template< size_t size_ >
+    span( T ( &array_ )[ size_ ] )
+      : m_data( array_ )
+      , m_size( size_ )
+    {}
+
+    template< typename container_t, typename = enable_if_container_t< container_t > >
+    span( container_t& c_ )
+      : m_data( c_.data() )
+      , m_size( c_.size() )
+    {}
+
+    T* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    T* begin() const { return m_data; }
+    T* end() const { return m_data + m_size; }
+
+    T& operator[]( size_t index_ ) const { return m_data[ index_ ]; }
+
+  private:
+
+    T* m_data = nullptr;
+    size_t m_size = 0;
+  };
+
+}
+}
@@ -0,0 +1,178 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // spsc_queue
+  // -----------------------------------------------------------------------------
+
+  // Bounded wait-free queue for exactly one producer thread (push) and one consumer thread
+  // (pop / consume_one), usable as collection_t of basic_async_stream and basic_async_observer.
+  //
+  // Events live in a power-of-two ring buffer of uninitialized slots. The consumer owned head
+  // index and the producer owned tail index sit on separate cache lines, each next to a cached
+  // copy of the other side's index, so the shared indices are only re-read (acquire) when the
+  // queue looks full to the producer or empty to the consumer.
+  // Moving the queue is not thread-safe.
+  template< typename event_t >
+  class spsc_queue
+  {
+    using slot_t = typename std::aligned_storage< sizeof( event_t ), alignof( event_t ) >::type;
+
+    static constexpr size_t cache_line_size = 64;
+
+  public:
+
+    spsc_queue( size_t capacity_ )
+      : m_capacity( capacity_ )
+      , m_mask( round_up_to_power_of_two( capacity_ ) - 1 )
+      , m_slots( new slot_t[ m_mask + 1 ] )
+    {}
+
+    ~spsc_queue() { clear(); }
+
+    spsc_queue( const spsc_queue& ) = delete;
+    spsc_queue& operator= ( const spsc_queue& ) = delete;
+
+    spsc_queue( spsc_queue&& other_ ) { *this = std::move( other_ ); }
+    spsc_queue& operator= ( spsc_queue&& other_ )
+    {
+      if( this == &other_ )
+        return *this;
+
+      clear();
+      m_capacity = other_.m_capacity;
+      m_mask = other_.m_mask;
+      m_slots = std::move( other_.m_slots );
+      m_head.store( other_.m_head.load() );
+      m_tail.store( other_.m_tail.load() );
+      m_cachedHead = other_.m_cachedHead;
+      m_cachedTail = other_.m_cachedTail;
+
+      other_.m_capacity = 0;
+      other_.m_head.store( 0 );
+      other_.m_tail.store( 0 );
+      other_.m_cachedHead = other_.m_cachedTail = 0;
+      return *this;
+    }
+
+
+    // producer side
+
+    bool push( const event_t& e_ ) { return emplace( e_ ); }
+    bool push( event_t&& e_ ) { return emplace( std::move( e_ ) ); }
+
+    // consumer side
+
+    bool pop( event_t& e_ )
+    {
+      return consume_one( [&e_]( event_t& front_ ) { e_ = std::move( front_ ); } );
+    }
+
+    // invokes fn_ with the oldest event in place, then removes it
+    template< typename fn_t >
+    bool consume_one( fn_t&& fn_ )
+    {
+      auto head = m_head.load( std::memory_order_relaxed );
+      if( head == m_cachedTail )
+      {
+        m_cachedTail = m_tail.load( std::memory_order_acquire );
+        if( head == m_cachedTail )
+          return false;
+      }
+
+      auto& e = at( head );
+      fn_( e );
+      e.~event_t();
+      m_head.store( head + 1, std::memory_order_release );
+      return true;
+    }
+
+    // only snapshots if called while the other side is active
+    bool empty() const { return size() == 0; }
+
+    size_t size() const
+    {
+      auto head = m_head.load( std::memory_order_acquire );
+      return m_tail.load( std::memory_order_acquire ) - head;
+    }
+
+  private:
+
+    static size_t round_up_to_power_of_two( size_t n_ )
+    {
+      size_t p = 1;
+      while( p < n_ )
+        p <<= 1;
+      return p;
+    }
+
+    event_t& at( size_t index_ ) const { return *reinterpret_cast< event_t* >( &m_slots[ index_ & m_mask ] ); }
+
+    template< typename arg_t >
+    bool emplace( arg_t&& e_ )
+    {
+      auto tail = m_tail.load( std::memory_order_relaxed );
+      if( tail - m_cachedHead >= m_capacity )
+      {
+        m_cachedHead = m_head.load( std::memory_order_acquire );
+        if( tail - m_cachedHead >= m_capacity )
+          return false;
+      }
+
+      new ( &at( tail ) ) event_t( std::forward< arg_t >( e_ ) );
+      m_tail.store( tail + 1, std::memory_order_release );
+      return true;
+    }
+
+    void clear()
+    {
+      while( consume_one( []( event_t& ) {} ) ) {}
+    }
+
+
+    // read-only after construction
+    size_t m_capacity = 0;
+    size_t m_mask = 0;
+    std::unique_ptr< slot_t[] > m_slots;
+
+    // consumer
+    alignas( cache_line_size ) std::atomic< size_t > m_head{ 0 };
+    size_t m_cachedTail = 0;
+
+    // producer (the size of the queue is rounded up to the cache line alignment, so
+    // nothing following the queue can share this line)
+    alignas( cache_line_size ) std::atomic< size_t > m_tail{ 0 };
+    size_t m_cachedHead = 0;
+  };
+
+}
+}
@@ -0,0 +1,100 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "span.h"
+
+#include <tuple>
+#include <utility>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // static_stream
+  // -----------------------------------------------------------------------------
+
+  // Stream whose observers are fixed at compile time. The observers are held by reference
+  // in a tuple and dispatching an event expands into one direct call per observer - there
+  // is no observer list, lock or virtual dispatch involved, so the whole wiring can be inlined.
+  //
+  // Observers can be of any type providing on_event( event_t& ) and on_done(). basic_observer
+  // derived observers should mark these final, otherwise the calls remain virtual.
+  // static_stream is not thread-safe and does not own the observers, which must outlive it.
+  template< typename event_t, typename... observers_t >
+  class static_stream
+  {
+    using indices_t = std::index_sequence_for< observers_t... >;
+
+  public:
+
+    using event_type = event_t;
+
+    explicit static_stream( observers_t&... observers_ )
+      : m_observers( observers_... )
+    {}
+
+    static_stream& operator << ( event_t e_ )
+    {
+      dispatch( e_, indices_t() );
+      return *this;
+    }
+
+    static_stream& push_events( span< event_t > events_ )
+    {
+      for( auto& e : events_ )
+        dispatch( e, indices_t() );
+      return *this;
+    }
+
+    void on_done() { done( indices_t() ); }
+
+    static constexpr size_t observer_count() { return sizeof...( observers_t ); }
+
+  private:
+
+    template< size_t... indices_ >
+    void dispatch( event_t& e_, std::index_sequence< indices_... > )
+    {
+      using expand_t = int[];
+      (void)expand_t{ 0, ( std::get< indices_ >( m_observers ).on_event( e_ ), 0 )... };
+    }
+
+    template< size_t... indices_ >
+    void done( std::index_sequence< indices_... > )
+    {
+      using expand_t = int[];
+      (void)expand_t{ 0, ( std::get< indices_ >( m_observers ).on_done(), 0 )... };
+    }
+
+
+    std::tuple< observers_t&... > m_observers;
+  };
+
+
+  template< typename event_t, typename... observers_t >
+  static_stream< event_t, observers_t... > make_static_stream( observers_t&... observers_ )
+  {
+    return static_stream< event_t, observers_t... >( observers_... );
+  }
+
+}
+}
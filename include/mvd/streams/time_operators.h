@@ -0,0 +1,664 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "basic_stream.h"
+#include "timer_wheel.h"
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // Time based operators. They read the time from the given timer_wheel and use its timers,
+  // so they only see time pass when the wheel is advanced, and the wheel has to be advanced
+  // on the thread that dispatches the events of the source stream.
+
+  namespace detail
+  {
+    // ---------------------------------------------------------------------------
+    // timed_source
+    // ---------------------------------------------------------------------------
+
+    // common part of the time based sources: owns at most one timer of the wheel, which
+    // invokes on_timer. Copies don't take over the timer or pending events
+    template< typename event_t, typename access_policy_t >
+    class timed_source : public basic_observer< event_t, access_policy_t >
+    {
+      using base_t = basic_observer< event_t, access_policy_t >;
+
+    public:
+
+      template< typename stream_t >
+      timed_source( stream_t& s_, timer_wheel& wheel_ )
+        : m_wheel( &wheel_ )
+      {
+        s_.subscribe( *this );
+      }
+
+      ~timed_source() override { disarm(); }
+
+      timed_source( const timed_source& other_ ) : base_t() { *this = other_; }
+      timed_source& operator= ( const timed_source& other_ )
+      {
+        disarm();
+        base_t::operator= ( other_ );
+        m_wheel = other_.m_wheel;
+        m_pOutStream = nullptr;
+        return *this;
+      }
+
+      timed_source( timed_source&& other_ ) : base_t() { *this = std::move( other_ ); }
+      timed_source& operator= ( timed_source&& other_ )
+      {
+        disarm();
+        other_.disarm();
+        base_t::operator= ( std::move( other_ ) );
+        m_wheel = other_.m_wheel;
+        m_pOutStream = nullptr;
+        return *this;
+      }
+
+      void on_done() override { /*! \todo */ }
+
+    protected:
+
+      using stream_t = basic_stream< event_t, access_policy_t >;
+      using time_point = timer_wheel::time_point;
+      using duration = timer_wheel::duration;
+
+      virtual void on_timer() = 0;
+
+      time_point now() const { return m_wheel->now(); }
+
+      void arm( time_point deadline_ )
+      {
+        disarm();
+        m_timer = m_wheel->schedule( deadline_, [this]()
+        {
+          m_timer = timer_wheel::timer_id();
+          on_timer();
+        });
+      }
+
+      void disarm()
+      {
+        if( m_timer )
+          m_wheel->cancel( m_timer );
+        m_timer = timer_wheel::timer_id();
+      }
+
+      bool armed() const { return static_cast< bool >( m_timer ); }
+
+      template< typename arg_t >
+      void emit( arg_t&& e_ )
+      {
+        if( m_pOutStream )
+          *m_pOutStream << std::forward< arg_t >( e_ );
+      }
+
+      stream_t* m_pOutStream = nullptr;
+
+    private:
+
+      timer_wheel* m_wheel = nullptr;
+      timer_wheel::timer_id m_timer;
+    };
+
+
+    // holds the latest event, reusing its storage. Events needn't be default constructible
+    template< typename event_t >
+    class latest_event
+    {
+    public:
+
+      template< typename arg_t >
+      void set( arg_t&& e_ )
+      {
+        if( m_event.empty() )
+          m_event.push_back( std::forward< arg_t >( e_ ) );
+        else
+          m_event.front() = std::forward< arg_t >( e_ );
+      }
+
+      bool empty() const { return m_event.empty(); }
+
+      event_t take()
+      {
+        event_t e = std::move( m_event.front() );
+        m_event.clear();
+        return e;
+      }
+
+      void clear() { m_event.clear(); }
+
+    private:
+
+      std::vector< event_t > m_event;
+    };
+  }
+
+
+  // ---------------------------------------------------------------------------
+  // delay_source
+  // ---------------------------------------------------------------------------
+
+  // the delay is the same for all events, so their deadlines are ordered and only the
+  // earliest one needs a timer
+  template< typename event_t, typename access_policy_t >
+  class delay_source : public detail::timed_source< event_t, access_policy_t >
+  {
+    using base_t = detail::timed_source< event_t, access_policy_t >;
+    using typename base_t::stream_t;
+    using typename base_t::duration;
+    using typename base_t::time_point;
+
+  public:
+
+    template< typename src_stream_t >
+    delay_source( src_stream_t& s_, timer_wheel& wheel_, duration delay_ )
+      : base_t( s_, wheel_ )
+      , m_delay( delay_ )
+    {}
+
+    delay_source( const delay_source& other_ )
+      : base_t( other_ )
+      , m_delay( other_.m_delay )
+    {}
+
+    delay_source( delay_source&& other_ )
+      : base_t( std::move( other_ ) )
+      , m_delay( other_.m_delay )
+    {}
+
+    void attach( stream_t& s_ ) { this->m_pOutStream = &s_; }
+
+    void on_event( event_t& e_ ) final { push( e_ ); }
+    void take_event( event_t&& e_ ) final { push( std::move( e_ ) ); }
+
+  private:
+
+    template< typename arg_t >
+    void push( arg_t&& e_ )
+    {
+      m_pending.emplace_back( this->now() + m_delay, std::forward< arg_t >( e_ ) );
+      if( !this->armed() )
+        this->arm( m_pending.front().first );
+    }
+
+    void on_timer() final
+    {
+      auto now = this->now();
+      while( !m_pending.empty() && m_pending.front().first <= now )
+      {
+        auto e = std::move( m_pending.front().second );
+        m_pending.pop_front();
+        this->emit( std::move( e ) );
+      }
+
+      if( !m_pending.empty() )
+        this->arm( m_pending.front().first );
+    }
+
+
+    duration m_delay;
+    std::deque< std::pair< time_point, event_t > > m_pending;
+  };
+
+
+  // ---------------------------------------------------------------------------
+  // timeout_source
+  // ---------------------------------------------------------------------------
+
+  // passes events on unchanged and emits the fallback event once whenever no event arrived
+  // for the given time. The timer isn't moved for every event, it is checked when it fires
+  template< typename event_t, typename access_policy_t >
+  class timeout_source : public detail::timed_source< event_t, access_policy_t >
+  {
+    using base_t = detail::timed_source< event_t, access_policy_t >;
+    using typename base_t::stream_t;
+    using typename base_t::duration;
+    using typename base_t::time_point;
+
+  public:
+
+    template< typename src_stream_t >
+    timeout_source( src_stream_t& s_, timer_wheel& wheel_, duration timeout_, event_t fallback_ )
+      : base_t( s_, wheel_ )
+      , m_timeout( timeout_ )
+      , m_fallback( std::move( fallback_ ) )
+    {}
+
+    timeout_source( const timeout_source& other_ )
+      : base_t( other_ )
+      , m_timeout( other_.m_timeout )
+      , m_fallback( other_.m_fallback )
+    {}
+
+    timeout_source( timeout_source&& other_ )
+      : base_t( std::move( other_ ) )
+      , m_timeout( other_.m_timeout )
+      , m_fallback( std::move( other_.m_fallback ) )
+    {}
+
+    // the first timeout counts from here
+    void attach( stream_t& s_ )
+    {
+      this->m_pOutStream = &s_;
+      restart();
+    }
+
+    void on_event( event_t& e_ ) final
+    {
+      restart();
+      this->emit( e_ );
+    }
+
+    void take_event( event_t&& e_ ) final
+    {
+      restart();
+      this->emit( std::move( e_ ) );
+    }
+
+  private:
+
+    void restart()
+    {
+      m_lastEvent = this->now();
+      if( !this->armed() )
+        this->arm( m_lastEvent + m_timeout );
+    }
+
+    void on_timer() final
+    {
+      if( this->now() < m_lastEvent + m_timeout )
+        this->arm( m_lastEvent + m_timeout );
+      else
+        this->emit( m_fallback );
+    }
+
+
+    duration m_timeout;
+    event_t m_fallback;
+    time_point m_lastEvent;
+  };
+
+
+  // ---------------------------------------------------------------------------
+  // debounce_source
+  // ---------------------------------------------------------------------------
+
+  // emits the latest event once no further event arrived for the given time
+  template< typename event_t, typename access_policy_t >
+  class debounce_source : public detail::timed_source< event_t, access_policy_t >
+  {
+    using base_t = detail::timed_source< event_t, access_policy_t >;
+    using typename base_t::stream_t;
+    using typename base_t::duration;
+    using typename base_t::time_point;
+
+  public:
+
+    template< typename src_stream_t >
+    debounce_source( src_stream_t& s_, timer_wheel& wheel_, duration quietTime_ )
+      : base_t( s_, wheel_ )
+      , m_quietTime( quietTime_ )
+    {}
+
+    debounce_source( const debounce_source& other_ )
+      : base_t( other_ )
+      , m_quietTime( other_.m_quietTime )
+    {}
+
+    debounce_source( debounce_source&& other_ )
+      : base_t( std::move( other_ ) )
+      , m_quietTime( other_.m_quietTime )
+    {}
+
+    void attach( stream_t& s_ ) { this->m_pOutStream = &s_; }
+
+    void on_event( event_t& e_ ) final { push( e_ ); }
+    void take_event( event_t&& e_ ) final { push( std::move( e_ ) ); }
+
+  private:
+
+    template< typename arg_t >
+    void push( arg_t&& e_ )
+    {
+      m_latest.set( std::forward< arg_t >( e_ ) );
+      m_lastEvent = this->now();
+      if( !this->armed() )
+        this->arm( m_lastEvent + m_quietTime );
+    }
+
+    void on_timer() final
+    {
+      if( this->now() < m_lastEvent + m_quietTime )
+        this->arm( m_lastEvent + m_quietTime );
+      else if( !m_latest.empty() )
+        this->emit( m_latest.take() );
+    }
+
+
+    duration m_quietTime;
+    detail::latest_event< event_t > m_latest;
+    time_point m_lastEvent;
+  };
+
+
+  // ---------------------------------------------------------------------------
+  // throttle_first_source
+  // ---------------------------------------------------------------------------
+
+  // emits an event, then drops all events for the given time
+  template< typename event_t, typename access_policy_t >
+  class throttle_first_source : public detail::timed_source< event_t, access_policy_t >
+  {
+    using base_t = detail::timed_source< event_t, access_policy_t >;
+    using typename base_t::stream_t;
+    using typename base_t::duration;
+    using typename base_t::time_point;
+
+  public:
+
+    template< typename src_stream_t >
+    throttle_first_source( src_stream_t& s_, timer_wheel& wheel_, duration window_ )
+      : base_t( s_, wheel_ )
+      , m_window( window_ )
+    {}
+
+    throttle_first_source( const throttle_first_source& other_ )
+      : base_t( other_ )
+      , m_window( other_.m_window )
+    {}
+
+    throttle_first_source( throttle_first_source&& other_ )
+      : base_t( std::move( other_ ) )
+      , m_window( other_.m_window )
+    {}
+
+    void attach( stream_t& s_ ) { this->m_pOutStream = &s_; }
+
+    void on_event( event_t& e_ ) final
+    {
+      if( open_window() )
+        this->emit( e_ );
+    }
+
+    void take_event( event_t&& e_ ) final
+    {
+      if( open_window() )
+        this->emit( std::move( e_ ) );
+    }
+
+  private:
+
+    // no timer needed, the window is checked when the next event arrives
+    bool open_window()
+    {
+      auto now = this->now();
+      if( m_hasWindow && now < m_windowEnd )
+        return false;
+
+      m_hasWindow = true;
+      m_windowEnd = now + m_window;
+      return true;
+    }
+
+    void on_timer() final {}
+
+
+    duration m_window;
+    time_point m_windowEnd;
+    bool m_hasWindow = false;
+  };
+
+
+  // ---------------------------------------------------------------------------
+  // throttle_last_source
+  // ---------------------------------------------------------------------------
+
+  // the first event opens a window of the given time, at its end the latest event received
+  // within it is emitted
+  template< typename event_t, typename access_policy_t >
+  class throttle_last_source : public detail::timed_source< event_t, access_policy_t >
+  {
+    using base_t = detail::timed_source< event_t, access_policy_t >;
+    using typename base_t::stream_t;
+    using typename base_t::duration;
+
+  public:
+
+    template< typename src_stream_t >
+    throttle_last_source( src_stream_t& s_, timer_wheel& wheel_, duration window_ )
+      : base_t( s_, wheel_ )
+      , m_window( window_ )
+    {}
+
+    throttle_last_source( const throttle_last_source& other_ )
+      : base_t( other_ )
+      , m_window( other_.m_window )
+    {}
+
+    throttle_last_source( throttle_last_source&& other_ )
+      : base_t( std::move( other_ ) )
+      , m_window( other_.m_window )
+    {}
+
+    void attach( stream_t& s_ ) { this->m_pOutStream = &s_; }
+
+    void on_event( event_t& e_ ) final { push( e_ ); }
+    void take_event( event_t&& e_ ) final { push( std::move( e_ ) ); }
+
+  private:
+
+    template< typename arg_t >
+    void push( arg_t&& e_ )
+    {
+      m_latest.set( std::forward< arg_t >( e_ ) );
+      if( !this->armed() )
+        this->arm( this->now() + m_window );
+    }
+
+    void on_timer() final
+    {
+      if( !m_latest.empty() )
+        this->emit( m_latest.take() );
+    }
+
+
+    duration m_window;
+    detail::latest_event< event_t > m_latest;
+  };
+
+
+  // ---------------------------------------------------------------------------
+  // sample_source
+  // ---------------------------------------------------------------------------
+
+  // emits the latest event at every interval, if one arrived since the previous sample
+  template< typename event_t, typename access_policy_t >
+  class sample_source : public detail::timed_source< event_t, access_policy_t >
+  {
+    using base_t = detail::timed_source< event_t, access_policy_t >;
+    using typename base_t::stream_t;
+    using typename base_t::duration;
+    using typename base_t::time_point;
+
+  public:
+
+    template< typename src_stream_t >
+    sample_source( src_stream_t& s_, timer_wheel& wheel_, duration interval_ )
+      : base_t( s_, wheel_ )
+      , m_interval( interval_ )
+    {}
+
+    sample_source( const sample_source& other_ )
+      : base_t( other_ )
+      , m_interval( other_.m_interval )
+    {}
+
+    sample_source( sample_source&& other_ )
+      : base_t( std::move( other_ ) )
+      , m_interval( other_.m_interval )
+    {}
+
+    // sampling starts here
+    void attach( stream_t& s_ )
+    {
+      this->m_pOutStream = &s_;
+      if( !this->armed() )
+      {
+        m_nextSample = this->now() + m_interval;
+        this->arm( m_nextSample );
+      }
+    }
+
+    void on_event( event_t& e_ ) final { m_latest.set( e_ ); }
+    void take_event( event_t&& e_ ) final { m_latest.set( std::move( e_ ) ); }
+
+  private:
+
+    void on_timer() final
+    {
+      // the samples stay on the interval grid, unless the wheel skipped whole intervals
+      auto now = this->now();
+      m_nextSample += m_interval;
+      if( m_nextSample <= now )
+        m_nextSample = now + m_interval;
+      this->arm( m_nextSample );
+
+      if( !m_latest.empty() )
+        this->emit( m_latest.take() );
+    }
+
+
+    duration m_interval;
+    detail::latest_event< event_t > m_latest;
+    time_point m_nextSample;
+  };
+
+
+  // -----------------------------------------------------------------------------
+  // operators
+  // -----------------------------------------------------------------------------
+
+  template< typename stream_t >
+  basic_stream< typename stream_t::event_type, typename stream_t::access_policy >
+  delay(
+    stream_t& s_,
+    timer_wheel& wheel_,
+    timer_wheel::duration delay_
+  )
+  {
+    using event_t = typename stream_t::event_type;
+    using access_policy_t = typename stream_t::access_policy;
+
+    return basic_stream< event_t, access_policy_t >(
+      delay_source< event_t, access_policy_t >( s_, wheel_, delay_ )
+    );
+  }
+
+  template< typename stream_t >
+  basic_stream< typename stream_t::event_type, typename stream_t::access_policy >
+  timeout(
+    stream_t& s_,
+    timer_wheel& wheel_,
+    timer_wheel::duration timeout_,
+    typename stream_t::event_type fallback_
+  )
+  {
+    using event_t = typename stream_t::event_type;
+    using access_policy_t = typename stream_t::access_policy;
+
+    return basic_stream< event_t, access_policy_t >(
+      timeout_source< event_t, access_policy_t >( s_, wheel_, timeout_, std::move( fallback_ ) )
+    );
+  }
+
+  template< typename stream_t >
+  basic_stream< typename stream_t::event_type, typename stream_t::access_policy >
+  debounce(
+    stream_t& s_,
+    timer_wheel& wheel_,
+    timer_wheel::duration quietTime_
+  )
+  {
+    using event_t = typename stream_t::event_type;
+    using access_policy_t = typename stream_t::access_policy;
+
+    return basic_stream< event_t, access_policy_t >(
+      debounce_source< event_t, access_policy_t >( s_, wheel_, quietTime_ )
+    );
+  }
+
+  template< typename stream_t >
+  basic_stream< typename stream_t::event_type, typename stream_t::access_policy >
+  throttle_first(
+    stream_t& s_,
+    timer_wheel& wheel_,
+    timer_wheel::duration window_
+  )
+  {
+    using event_t = typename stream_t::event_type;
+    using access_policy_t = typename stream_t::access_policy;
+
+    return basic_stream< event_t, access_policy_t >(
+      throttle_first_source< event_t, access_policy_t >( s_, wheel_, window_ )
+    );
+  }
+
+  template< typename stream_t >
+  basic_stream< typename stream_t::event_type, typename stream_t::access_policy >
+  throttle_last(
+    stream_t& s_,
+    timer_wheel& wheel_,
+    timer_wheel::duration window_
+  )
+  {
+    using event_t = typename stream_t::event_type;
+    using access_policy_t = typename stream_t::access_policy;
+
+    return basic_stream< event_t, access_policy_t >(
+      throttle_last_source< event_t, access_policy_t >( s_, wheel_, window_ )
+    );
+  }
+
+  template< typename stream_t >
+  basic_stream< typename stream_t::event_type, typename stream_t::access_policy >
+  sample(
+    stream_t& s_,
+    timer_wheel& wheel_,
+    timer_wheel::duration interval_
+  )
+  {
+    using event_t = typename stream_t::event_type;
+    using access_policy_t = typename stream_t::access_policy;
+
+    return basic_stream< event_t, access_policy_t >(
+      sample_source< event_t, access_policy_t >( s_, wheel_, interval_ )
+    );
+  }
+
+}
+}
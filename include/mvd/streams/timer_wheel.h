@@ -0,0 +1,297 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "inline_function.h"
+#include "slab.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // timer_wheel
+  // -----------------------------------------------------------------------------
+
+  // Timer service for the time based operators (see time_operators.h), a hierarchical timing
+  // wheel with four levels of 256 slots. Level n covers 256^(n+1) ticks. A timer is linked
+  // into the slot of the level its deadline falls into, so scheduling and cancelling are
+  // O(1), and whenever a lower level wraps around, the timers of the next slot of the level
+  // above are redistributed (cascaded) into the levels below.
+  //
+  // Timers are stored in slab chunks and recycled, and the callbacks are inline_functions, so
+  // scheduling a timer doesn't allocate once the wheel is warmed up.
+  //
+  // Time is advanced explicitly by calling advance, which also invokes the callbacks of the
+  // expired timers - e.g. from the thread that dispatches the events of the streams using the
+  // wheel. Callbacks may schedule and cancel timers. Not thread-safe.
+  class timer_wheel
+  {
+    static constexpr unsigned level_count = 4;
+    static constexpr unsigned slot_bits = 8;
+    static constexpr std::uint64_t slot_count = std::uint64_t( 1 ) << slot_bits;
+    static constexpr std::uint64_t slot_mask = slot_count - 1;
+
+  public:
+
+    using clock_t = std::chrono::steady_clock;
+    using time_point = clock_t::time_point;
+    using duration = clock_t::duration;
+    using callback_t = inline_function< void() >;
+
+  private:
+
+    struct node
+    {
+      node** head = nullptr;  // of the slot it is linked into, nullptr if it isn't scheduled
+      node* prev = nullptr;
+      node* next = nullptr;   // also links the free list
+      std::uint64_t expiry = 0;
+      std::uint32_t generation = 0;
+      unsigned level = 0;
+      callback_t callback;
+    };
+
+  public:
+
+    // identifies a scheduled timer, stays valid (but inert) after the timer fired
+    class timer_id
+    {
+      friend class timer_wheel;
+
+    public:
+
+      timer_id() = default;
+
+      explicit operator bool() const { return m_node != nullptr; }
+
+    private:
+
+      timer_id( node* node_, std::uint32_t generation_ )
+        : m_node( node_ )
+        , m_generation( generation_ )
+      {}
+
+      node* m_node = nullptr;
+      std::uint32_t m_generation = 0;
+    };
+
+
+    explicit timer_wheel( duration tick_ = std::chrono::milliseconds( 1 ), time_point start_ = clock_t::now() )
+      : m_tick( tick_ > duration::zero() ? tick_ : duration( 1 ) )
+      , m_start( start_ )
+    {}
+
+    timer_wheel( const timer_wheel& ) = delete;
+    timer_wheel& operator= ( const timer_wheel& ) = delete;
+
+    // fn_ is invoked by the first advance reaching deadline_, at the earliest on the next tick
+    timer_id schedule( time_point deadline_, callback_t fn_ )
+    {
+      node& n = allocate();
+      n.expiry = std::max( to_ticks( deadline_ ), m_now + 1 );
+      n.callback = std::move( fn_ );
+      link( n );
+      ++m_size;
+      return timer_id( &n, n.generation );
+    }
+
+    timer_id schedule( duration delay_, callback_t fn_ )
+    {
+      return schedule( now() + delay_, std::move( fn_ ) );
+    }
+
+    // returns false if the timer already fired or was cancelled
+    bool cancel( timer_id id_ )
+    {
+      node* n = id_.m_node;
+      if( !n || n->generation != id_.m_generation || !n->head )
+        return false;
+
+      unlink( *n );
+      release( *n );
+      --m_size;
+      return true;
+    }
+
+    // advances the time to now_ and invokes the callbacks of all timers that expired until
+    // then, in the order of their deadlines. Returns the number of invoked callbacks
+    size_t advance( time_point now_ = clock_t::now() )
+    {
+      auto target = now_ > m_start ? static_cast< std::uint64_t >( ( now_ - m_start ) / m_tick ) : 0;
+
+      size_t fired = 0;
+      while( m_now < target )
+      {
+        if( m_size == 0 )
+        {
+          m_now = target;
+          break;
+        }
+
+        // as long as the lower levels are empty nothing can happen before the next of them
+        // wraps around, so idle periods are skipped instead of stepped through tick by tick
+        unsigned emptyLevels = 0;
+        while( m_levelSizes[ emptyLevels ] == 0 )
+          ++emptyLevels;  // m_size > 0, so not all of them are empty
+
+        if( emptyLevels > 0 )
+        {
+          auto lastBeforeWrap = m_now | ( ( std::uint64_t( 1 ) << ( slot_bits * emptyLevels ) ) - 1 );
+          m_now = std::min( target, lastBeforeWrap );
+          if( m_now == target )
+            break;
+        }
+
+        ++m_now;
+        if( ( m_now & slot_mask ) == 0 )
+          cascade( 1 );
+
+        node** head = &m_slots[0][ m_now & slot_mask ];
+        while( node* n = *head )
+        {
+          unlink( *n );
+          auto callback = std::move( n->callback );
+          release( *n );
+          --m_size;
+
+          callback();
+          ++fired;
+        }
+      }
+      return fired;
+    }
+
+    // the time up to which the wheel has been advanced, rounded down to a tick
+    time_point now() const { return m_start + m_tick * static_cast< duration::rep >( m_now ); }
+
+    duration tick() const { return m_tick; }
+
+    // number of scheduled timers
+    size_t size() const { return m_size; }
+
+  private:
+
+    // rounded up, a timer never fires early
+    std::uint64_t to_ticks( time_point t_ ) const
+    {
+      if( t_ <= m_start )
+        return 0;
+      return static_cast< std::uint64_t >( ( t_ - m_start + m_tick - duration( 1 ) ) / m_tick );
+    }
+
+    node& allocate()
+    {
+      if( !m_freeList )
+        return m_nodes.emplace();
+
+      node* n = m_freeList;
+      m_freeList = n->next;
+      n->next = nullptr;
+      return *n;
+    }
+
+    void release( node& n_ )
+    {
+      n_.callback = nullptr;
+      ++n_.generation;
+      n_.next = m_freeList;
+      m_freeList = &n_;
+    }
+
+    void link( node& n_ )
+    {
+      auto delta = n_.expiry - m_now;
+
+      unsigned level = 0;
+      while( level + 1 < level_count && delta >= ( std::uint64_t( 1 ) << ( slot_bits * ( level + 1 ) ) ) )
+        ++level;
+
+      // beyond the range of the top level: parked in its farthest slot, and cascaded again
+      // until it is in range
+      auto expiry = n_.expiry;
+      auto range = std::uint64_t( 1 ) << ( slot_bits * level_count );
+      if( delta >= range )
+        expiry = m_now + range - 1;
+
+      node** head = &m_slots[ level ][ ( expiry >> ( slot_bits * level ) ) & slot_mask ];
+      n_.head = head;
+      n_.level = level;
+      ++m_levelSizes[ level ];
+      n_.prev = nullptr;
+      n_.next = *head;
+      if( *head )
+        ( *head )->prev = &n_;
+      *head = &n_;
+    }
+
+    void unlink( node& n_ )
+    {
+      if( n_.prev )
+        n_.prev->next = n_.next;
+      else
+        *n_.head = n_.next;
+
+      if( n_.next )
+        n_.next->prev = n_.prev;
+
+      --m_levelSizes[ n_.level ];
+      n_.head = nullptr;
+      n_.prev = nullptr;
+      n_.next = nullptr;
+    }
+
+    // moves the timers of the current slot of level_ down, after the levels below wrapped
+    void cascade( unsigned level_ )
+    {
+      if( level_ >= level_count )
+        return;
+
+      auto index = ( m_now >> ( slot_bits * level_ ) ) & slot_mask;
+      if( index == 0 )
+        cascade( level_ + 1 );
+
+      node** head = &m_slots[ level_ ][ index ];
+      while( node* n = *head )
+      {
+        unlink( *n );
+        link( *n );
+      }
+    }
+
+
+    duration m_tick;
+    time_point m_start;
+    std::uint64_t m_now = 0;  // in ticks since m_start
+    size_t m_size = 0;
+
+    node* m_slots[ level_count ][ slot_count ] = {};
+    size_t m_levelSizes[ level_count ] = {};
+    slab< node > m_nodes;
+    node* m_freeList = nullptr;
+  };
+
+}
+}
@@ -0,0 +1,288 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#pragma once
+
+#include "access_policy.h"
+#include "executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+
+  // -----------------------------------------------------------------------------
+  // work_stealing_executor
+  // -----------------------------------------------------------------------------
+
+  // Executor running the scheduled runnables (typically many async streams) on a fixed set
+  // of worker threads. A scheduled runnable is queued once on one worker's deque - the
+  // scheduling worker's own if it is scheduled from a worker thread, otherwise round robin.
+  // Workers take tasks from the front of their own deque and, when that is empty, steal from
+  // the back of the others' before they park.
+  //
+  // Each runnable carries a small state (see runnable::schedule_state) that guarantees it is
+  // queued at most once and run by at most one worker at a time, so the events of a stream
+  // are still dispatched in order. Scheduling a runnable that is running marks it dirty, and
+  // the worker queues it again once run() returns.
+  // A runnable must not detach itself from within run().
+  class work_stealing_executor : public executor
+  {
+    enum state_flags : unsigned
+    {
+      queued = 1,
+      running = 2,
+      dirty = 4,     // scheduled while running
+      detached = 8
+    };
+
+    struct alignas( 64 ) worker_queue
+    {
+      access_policy::spin_mutex mutex;
+      std::deque< runnable* > tasks;
+    };
+
+  public:
+
+    explicit work_stealing_executor( size_t workerCount_ = std::max( 1u, std::thread::hardware_concurrency() ) )
+      : m_queues( std::max< size_t >( workerCount_, 1 ) )
+    {
+      for( size_t i = 0; i < m_queues.size(); ++i )
+        m_workers.emplace_back( [this, i]() { loop( i ); } );
+    }
+
+    ~work_stealing_executor() override { stop(); }
+
+    work_stealing_executor( const work_stealing_executor& ) = delete;
+    work_stealing_executor& operator= ( const work_stealing_executor& ) = delete;
+
+    size_t worker_count() const { return m_queues.size(); }
+
+    void attach( runnable& r_ ) override
+    {
+      r_.schedule_state().store( 0 );
+      schedule( r_ );  // it may already have work
+    }
+
+    // waits for a running run() to return
+    void detach( runnable& r_ ) override
+    {
+      auto& state = r_.schedule_state();
+      state.fetch_or( detached );
+
+      // no new entries can appear now, so the runnable is either found in one of the deques
+      // or has been popped and marked running (both happen under the deque's lock)
+      for( auto& q : m_queues )
+      {
+        std::lock_guard< access_policy::spin_mutex > l( q.mutex );
+        auto it = std::find( q.tasks.begin(), q.tasks.end(), &r_ );
+        if( it != q.tasks.end() )
+        {
+          q.tasks.erase( it );
+          m_queuedCount.fetch_sub( 1 );
+        }
+      }
+
+      while( state.load() & running )
+        std::this_thread::yield();
+    }
+
+    void schedule( runnable& r_ ) override
+    {
+      auto& state = r_.schedule_state();
+      auto s = state.load();
+      for( ;; )
+      {
+        if( s & ( detached | queued ) )
+          return;
+
+        if( s & running )
+        {
+          if( ( s & dirty ) || state.compare_exchange_weak( s, s | dirty ) )
+            return;
+          continue;
+        }
+
+        // idle. If that changed in the meantime, look at the new state again
+        if( enqueue( target_queue(), r_, s ) )
+          return;
+        s = state.load();
+      }
+    }
+
+    // finishes the queued tasks and joins the workers
+    void stop()
+    {
+      {
+        std::lock_guard< std::mutex > l( m_parkMutex );
+        if( m_stopped.exchange( true ) )
+          return;
+        m_wakeup.notify_all();
+      }
+      for( auto& w : m_workers )
+        w.join();
+    }
+
+  private:
+
+    struct current_worker
+    {
+      const work_stealing_executor* executor = nullptr;
+      size_t index = 0;
+    };
+
+    static current_worker& this_thread_worker()
+    {
+      static thread_local current_worker w;
+      return w;
+    }
+
+    size_t target_queue()
+    {
+      auto& w = this_thread_worker();
+      if( w.executor == this )
+        return w.index;
+      return m_nextQueue.fetch_add( 1, std::memory_order_relaxed ) % m_queues.size();
+    }
+
+    // moves r_ from expected_ (idle or running + dirty) to queued and pushes it, under the
+    // lock so detach can't miss it. Fails if the state isn't expected_ anymore
+    bool enqueue( size_t index_, runnable& r_, unsigned expected_ )
+    {
+      auto& q = m_queues[ index_ ];
+      {
+        std::lock_guard< access_policy::spin_mutex > l( q.mutex );
+        if( !r_.schedule_state().compare_exchange_strong( expected_, queued ) )
+          return false;
+        q.tasks.push_back( &r_ );
+        m_queuedCount.fetch_add( 1 );
+      }
+
+      if( m_parkedCount.load() > 0 )
+      {
+        std::lock_guard< std::mutex > l( m_parkMutex );
+        m_wakeup.notify_one();
+      }
+      return true;
+    }
+
+    // pops a task and marks it running. Own queue from the front, others from the back
+    runnable* take( size_t index_ )
+    {
+      for( size_t i = 0; i < m_queues.size(); ++i )
+      {
+        auto& q = m_queues[ ( index_ + i ) % m_queues.size() ];
+        std::lock_guard< access_policy::spin_mutex > l( q.mutex );
+        if( q.tasks.empty() )
+          continue;
+
+        runnable* r;
+        if( i == 0 )
+        {
+          r = q.tasks.front();
+          q.tasks.pop_front();
+        }
+        else
+        {
+          r = q.tasks.back();
+          q.tasks.pop_back();
+        }
+        m_queuedCount.fetch_sub( 1 );
+
+        // queued -> running, keeping the detached flag
+        auto& state = r->schedule_state();
+        if( state.fetch_xor( queued | running ) & detached )
+        {
+          state.fetch_and( ~unsigned( running ) );  // detach is about to remove it anyway
+          continue;
+        }
+        return r;
+      }
+      return nullptr;
+    }
+
+    void execute( size_t index_, runnable& r_ )
+    {
+      r_.run();
+
+      auto& state = r_.schedule_state();
+      auto s = state.load();
+      for( ;; )
+      {
+        if( ( s & dirty ) && !( s & detached ) )
+        {
+          if( enqueue( index_, r_, s ) )  // running + dirty -> queued
+            return;
+          s = state.load();  // detached meanwhile
+          continue;
+        }
+
+        // the last access to r_, it may be destroyed right after
+        if( state.compare_exchange_weak( s, s & detached ) )
+          return;
+      }
+    }
+
+    void loop( size_t index_ )
+    {
+      this_thread_worker() = current_worker{ this, index_ };
+
+      for( ;; )
+      {
+        if( auto r = take( index_ ) )
+        {
+          execute( index_, *r );
+          continue;
+        }
+
+        std::unique_lock< std::mutex > l( m_parkMutex );
+        if( m_stopped.load() && m_queuedCount.load() == 0 )
+          return;
+
+        // counted as parked before the final check, enqueue increments m_queuedCount before
+        // it checks m_parkedCount, so one of them sees the other
+        m_parkedCount.fetch_add( 1 );
+        m_wakeup.wait( l, [this]() { return m_queuedCount.load() > 0 || m_stopped.load(); } );
+        m_parkedCount.fetch_sub( 1 );
+      }
+    }
+
+
+    std::vector< worker_queue > m_queues;
+    std::atomic< size_t > m_nextQueue{ 0 };
+    std::atomic< size_t > m_queuedCount{ 0 };
+
+    std::atomic< size_t > m_parkedCount{ 0 };
+    std::atomic< bool > m_stopped{ false };
+    std::mutex m_parkMutex;
+    std::condition_variable m_wakeup;
+
+    std::vector< std::thread > m_workers;
+  };
+
+}
+}
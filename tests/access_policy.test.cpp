@@ -0,0 +1,106 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/access_policy.h>
+
+#include <future>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "access_policy::spinning" )
+  {
+    SECTION( "try_lock fails while the mutex is held" )
+    {
+      access_policy::spinning::mutex_t m;
+      {
+        auto l = access_policy::spinning::scoped_lock( m );
+        CHECK( !m.try_lock() );
+      }
+      CHECK( m.try_lock() );
+      m.unlock();
+    }
+
+    SECTION( "The mutex is padded to a cache line" )
+    {
+      CHECK( alignof( access_policy::spinning::mutex_t ) == 64 );
+    }
+
+    SECTION( "Critical sections are mutually exclusive" )
+    {
+      access_policy::spinning::mutex_t m;
+      size_t counter = 0;
+
+      auto tasks = std::vector< std::future< void > >();
+      for( size_t i = 0; i < 8; ++i )
+      {
+        tasks.push_back( std::async(
+          std::launch::async,
+          [&m, &counter]()
+          {
+            for( size_t j = 0; j < 10000; ++j )
+            {
+              auto l = access_policy::spinning::scoped_lock( m );
+              ++counter;
+            }
+          }
+        ));
+      }
+      tasks.clear();
+
+      CHECK( counter == 80000 );
+    }
+  }
+
+
+  TEST_CASE( "access_policy::shared_locked" )
+  {
+    SECTION( "Shared locks can be held concurrently" )
+    {
+      access_policy::shared_locked::mutex_t m;
+
+      auto l1 = access_policy::shared_locked::scoped_shared_lock( m );
+      auto l2 = std::async(
+        std::launch::async,
+        [&m]() { return m.try_lock_shared() ? ( m.unlock_shared(), true ) : false; }
+      ).get();
+      CHECK( l2 );
+      CHECK( !m.try_lock() );
+    }
+  }
+
+
+  TEST_CASE( "access_policy::thread_confined" )
+  {
+    SECTION( "Can be locked repeatedly from the owning thread" )
+    {
+      access_policy::thread_confined::mutex_t m;
+      {
+        auto l = access_policy::thread_confined::scoped_lock( m );
+      }
+      auto l = access_policy::thread_confined::scoped_shared_lock( m );
+      SUCCEED();
+    }
+  }
+
+}
+}
@@ -27,7 +27,9 @@
 #endif
 #include <boost/lockfree/queue.hpp>
 
+#include <chrono>
 #include <future>
+#include <memory>
 #include <random>
 #include <set>
 #include <deque>
@@ -89,6 +91,21 @@ namespace streams
       CHECK( o.receivedValues.empty() );
     }
     
+    SECTION( "Batches are queued and dispatched on explicit request" )
+    {
+      test_observer o;
+      stream.subscribe( o );
+
+      std::vector< int > expectedValues = { 42, 314, 7, 0 };
+      stream.push_events( expectedValues );
+
+      REQUIRE( o.receivedValues.empty() );
+
+      stream.dispatch_events();
+
+      CHECK( o.receivedValues == expectedValues );
+    }
+
     SECTION( "onEvent hook is invoked" )
     {
       int receivedValue = 0;
@@ -193,6 +210,59 @@ namespace streams
   }
     
     
+  TEST_CASE( "basic_async_stream copies per event" )
+  {
+    struct copy_counter
+    {
+      copy_counter() = default;
+      copy_counter( size_t& copies_ ) : copies( &copies_ ) {}
+
+      copy_counter( const copy_counter& other_ ) : copies( other_.copies ) { ++*copies; }
+      copy_counter& operator= ( const copy_counter& other_ ) { copies = other_.copies; ++*copies; return *this; }
+
+      copy_counter( copy_counter&& ) = default;
+      copy_counter& operator= ( copy_counter&& ) = default;
+
+      size_t* copies = nullptr;
+    };
+
+    using stream_t = basic_async_stream< copy_counter, access_policy::none >;
+    using observer_t = basic_async_observer< copy_counter, access_policy::none >;
+
+    SECTION( "An rvalue is moved through stream and async observer queues" )
+    {
+      size_t copies = 0;
+      stream_t stream( 10u );
+      observer_t o( 10u );
+      stream.subscribe( o );
+
+      stream << copy_counter( copies );
+      stream.dispatch_events();
+
+      size_t processed = 0;
+      o.process_events( [&processed]( const copy_counter& ) { ++processed; } );
+
+      CHECK( processed == 1 );
+      CHECK( copies == 0 );
+    }
+
+    SECTION( "Only the async observers notified before the last one copy the event" )
+    {
+      size_t copies = 0;
+      stream_t stream( 10u );
+      observer_t o1( 10u ), o2( 10u ), o3( 10u );
+      stream.subscribe( o1 );
+      stream.subscribe( o2 );
+      stream.subscribe( o3 );
+
+      stream << copy_counter( copies );
+      stream.dispatch_events();
+
+      CHECK( copies == 2 );
+    }
+  }
+
+
   TEST_CASE( "basic_async_observer (lockfree queue)" )
   {
     struct test_observer
@@ -238,5 +308,153 @@ namespace streams
       CHECK( receivedValues.empty() );
     }
   }
+
+  TEST_CASE( "default_queue" )
+  {
+    SECTION( "Events are popped in FIFO order across the end of the buffer" )
+    {
+      default_queue< int > q( 4u );
+      int e = 0;
+
+      for( int i = 0; i < 10; ++i )
+      {
+        REQUIRE( q.push( i ) );
+        REQUIRE( q.push( i + 100 ) );
+        REQUIRE( q.pop( e ) );
+        CHECK( e == i );
+        REQUIRE( q.pop( e ) );
+        CHECK( e == i + 100 );
+      }
+      CHECK( !q.pop( e ) );
+    }
+
+    SECTION( "Push fails once the requested capacity is reached" )
+    {
+      default_queue< int > q( 3u );
+      CHECK( q.push( 1 ) );
+      CHECK( q.push( 2 ) );
+      CHECK( q.push( 3 ) );
+      CHECK( !q.push( 4 ) );
+      CHECK( q.size() == 3 );
+    }
+
+    SECTION( "Events don't need to be default constructible" )
+    {
+      struct no_default
+      {
+        explicit no_default( int v_ ) : value( v_ ) {}
+        int value;
+      };
+
+      default_queue< no_default > q( 2u );
+      q.push( no_default( 42 ) );
+
+      auto copy = q;
+      int value = 0;
+      CHECK( copy.consume_one( [&value]( no_default& e_ ) { value = e_.value; } ) );
+      CHECK( value == 42 );
+      CHECK( q.size() == 1 );
+    }
+
+    SECTION( "Queued events are destroyed with the queue" )
+    {
+      auto p = std::make_shared< int >( 0 );
+      {
+        default_queue< std::shared_ptr< int > > q( 4u );
+        q.push( p );
+        q.push( p );
+        CHECK( p.use_count() == 3 );
+      }
+      CHECK( p.use_count() == 1 );
+    }
+  }
+
+  TEST_CASE( "Bounded dispatching (basic_async_stream)" )
+  {
+    struct test_observer : basic_observer< int, access_policy::none >
+    {
+      void on_event( int& v_ ) final { receivedValues.push_back( v_ ); }
+      void on_done() final {}
+
+      std::vector< int > receivedValues;
+    };
+
+    basic_async_stream< int, access_policy::none > stream( 100u );
+    test_observer o;
+    stream.subscribe( o );
+
+    for( int i = 0; i < 10; ++i )
+      stream << i;
+
+    SECTION( "Dispatches at most the given number of events" )
+    {
+      auto r = stream.dispatch_events( 4u );
+      CHECK( r.processed == 4 );
+      CHECK( r.remaining == 6 );
+      CHECK( o.receivedValues == std::vector< int >{ 0, 1, 2, 3 } );
+
+      r = stream.dispatch_events( 100u );
+      CHECK( r.processed == 6 );
+      CHECK( r.remaining == 0 );
+    }
+
+    SECTION( "Dispatches nothing once the deadline has passed" )
+    {
+      auto r = stream.dispatch_events( std::chrono::steady_clock::now() - std::chrono::seconds( 1 ) );
+      CHECK( r.processed == 0 );
+      CHECK( r.remaining == 10 );
+    }
+
+    SECTION( "The event count also applies with a deadline" )
+    {
+      auto r = stream.dispatch_events( std::chrono::steady_clock::now() + std::chrono::seconds( 10 ), 3u );
+      CHECK( r.processed == 3 );
+      CHECK( r.remaining == 7 );
+    }
+  }
+
+
+  TEST_CASE( "Bounded processing (basic_async_observer)" )
+  {
+    basic_stream< int, access_policy::none > stream;
+    basic_async_observer< int, access_policy::none > o( 100u );
+    stream.subscribe( o );
+
+    for( int i = 0; i < 10; ++i )
+      stream << i;
+
+    auto received = std::vector< int >();
+    auto collect = [&received]( const int& e_ ) { received.push_back( e_ ); };
+
+    SECTION( "Processes at most the given number of events" )
+    {
+      auto r = o.process_events( collect, 4u );
+      CHECK( r.processed == 4 );
+      CHECK( r.remaining == 6 );
+      CHECK( received == std::vector< int >{ 0, 1, 2, 3 } );
+    }
+
+    SECTION( "Processes until the deadline" )
+    {
+      auto r = o.process_events( collect, std::chrono::steady_clock::now() - std::chrono::seconds( 1 ) );
+      CHECK( r.processed == 0 );
+
+      r = o.process_events( collect, std::chrono::steady_clock::now() + std::chrono::seconds( 10 ) );
+      CHECK( r.processed == 10 );
+      CHECK( r.remaining == 0 );
+    }
+
+    SECTION( "Queues without size() report whether events remain" )
+    {
+      basic_async_observer< int, access_policy::none, lockfree_queue_t > lockfree( 100u );
+      basic_stream< int, access_policy::none > s;
+      s.subscribe( lockfree );
+      s << 1 << 2 << 3;
+
+      auto r = lockfree.process_events( collect, 1u );
+      CHECK( r.processed == 1 );
+      CHECK( r.remaining == 1 );
+    }
+  }
+}
 }
-}
\ No newline at end of file
@@ -20,10 +20,14 @@
 
 #include <mvd/streams/basic_stream.h>
 #include <mvd/streams/access_policy.h>
+#include <mvd/streams/fork_join_pool.h>
 
+#include <atomic>
 #include <future>
 #include <random>
 #include <set>
+#include <thread>
+#include <vector>
 
 namespace mvd
 {
@@ -54,6 +58,61 @@ namespace streams
       CHECK( receivedValue == pushedValue );
     }
   
+    SECTION( "Unsubscribed lambda stops receiving events" )
+    {
+      int receivedValue1 = 0;
+      int receivedValue2 = 0;
+
+      stream_t stream;
+      auto s1 = stream.subscribe( [&receivedValue1]( int v_ ) { receivedValue1 = v_; } );
+      stream.subscribe( [&receivedValue2]( int v_ ) { receivedValue2 = v_; } );
+
+      stream.unsubscribe( s1 );
+      stream << 42;
+
+      CHECK( stream.get_observer_count() == 1 );
+      CHECK( receivedValue1 == 0 );
+      CHECK( receivedValue2 == 42 );
+    }
+
+    SECTION( "Unsubscribing a lambda twice has no effect" )
+    {
+      int receivedValue1 = 0;
+      int receivedValue2 = 0;
+
+      stream_t stream;
+      auto s1 = stream.subscribe( [&receivedValue1]( int v_ ) { receivedValue1 = v_; } );
+      auto copy = s1;
+      stream.unsubscribe( s1 );
+      stream.unsubscribe( copy );
+
+      // the new subscription reuses the slot of s1
+      stream.subscribe( [&receivedValue2]( int v_ ) { receivedValue2 = v_; } );
+      stream.unsubscribe( s1 );
+      stream << 42;
+
+      CHECK( stream.get_observer_count() == 1 );
+      CHECK( receivedValue1 == 0 );
+      CHECK( receivedValue2 == 42 );
+    }
+
+    SECTION( "Many lambda subscriptions keep receiving events" )
+    {
+      int receivedCount = 0;
+
+      stream_t stream;
+      std::vector< stream_t::lambda_subscription > subscriptions;
+      for( size_t i = 0; i < 1000; ++i )
+        subscriptions.push_back( stream.subscribe( [&receivedCount]( int ) { ++receivedCount; } ) );
+
+      for( size_t i = 0; i < subscriptions.size(); i += 2 )
+        stream.unsubscribe( subscriptions[i] );
+
+      stream << 42;
+
+      CHECK( receivedCount == 500 );
+    }
+
     SECTION( "Subscribing Observer receives events" )
     {
       stream_t stream;
@@ -480,5 +539,366 @@ namespace streams
       CHECK( o.receivedValues == expectedValues );
     }
   }
+
+  TEST_CASE( "Batch emission (basic_stream)" )
+  {
+    struct event_observer : basic_observer < int, access_policy::none >
+    {
+      void on_event( int& v_ ) final { values.push_back( v_ ); }
+      void on_done() final {}
+
+      std::vector< int > values;
+    };
+
+    struct batch_observer : basic_observer < int, access_policy::none >
+    {
+      void on_event( int& v_ ) final { values.push_back( v_ ); }
+      void on_events( span< int > events_ ) final
+      {
+        ++batchCount;
+        values.insert( values.end(), events_.begin(), events_.end() );
+      }
+      void on_done() final {}
+
+      std::vector< int > values;
+      size_t batchCount = 0;
+    };
+
+    using stream_t = basic_stream< int, access_policy::none >;
+
+    SECTION( "Observers without batch support receive all events of a batch one by one" )
+    {
+      stream_t stream;
+      event_observer o;
+      stream.subscribe( o );
+
+      std::vector< int > expectedValues = { 42, 314, 7, 0 };
+      stream.push_events( expectedValues );
+
+      CHECK( o.values == expectedValues );
+    }
+
+    SECTION( "Batch-aware observers receive the batch in one call" )
+    {
+      stream_t stream;
+      batch_observer o1;
+      batch_observer o2;
+      stream.subscribe( o1 );
+      stream.subscribe( o2 );
+
+      std::vector< int > expectedValues = { 42, 314, 7, 0 };
+      stream.push_events( expectedValues );
+
+      CHECK( o1.batchCount == 1 );
+      CHECK( o1.values == expectedValues );
+      CHECK( o2.batchCount == 1 );
+      CHECK( o2.values == expectedValues );
+    }
+
+    SECTION( "Empty batches are not dispatched" )
+    {
+      stream_t stream;
+      batch_observer o;
+      stream.subscribe( o );
+
+      stream.push_events( span< int >() );
+
+      CHECK( o.batchCount == 0 );
+    }
+  }
+
+
+  TEST_CASE( "Copies per event (basic_stream)" )
+  {
+    struct copy_counter
+    {
+      copy_counter() = default;
+      copy_counter( size_t& copies_ ) : copies( &copies_ ) {}
+
+      copy_counter( const copy_counter& other_ ) : copies( other_.copies ) { ++*copies; }
+      copy_counter& operator= ( const copy_counter& other_ ) { copies = other_.copies; ++*copies; return *this; }
+
+      copy_counter( copy_counter&& ) = default;
+      copy_counter& operator= ( copy_counter&& ) = default;
+
+      size_t* copies = nullptr;
+    };
+
+    struct moving_observer : basic_observer < copy_counter, access_policy::none >
+    {
+      void on_event( copy_counter& e_ ) final { received = e_; }
+      void take_event( copy_counter&& e_ ) final { received = std::move( e_ ); }
+      void on_done() final {}
+
+      copy_counter received;
+    };
+
+    using stream_t = basic_stream< copy_counter, access_policy::none >;
+
+    SECTION( "Pushing an rvalue moves it into the last observer" )
+    {
+      size_t copies = 0;
+      stream_t stream;
+      moving_observer o;
+      stream.subscribe( o );
+
+      stream << copy_counter( copies );
+
+      CHECK( copies == 0 );
+      CHECK( o.received.copies == &copies );
+    }
+
+    SECTION( "Pushing an lvalue copies it once" )
+    {
+      size_t copies = 0;
+      stream_t stream;
+      moving_observer o;
+      stream.subscribe( o );
+
+      copy_counter e( copies );
+      stream << e;
+
+      CHECK( copies == 1 );
+    }
+
+    SECTION( "All observers but the last one receive a reference" )
+    {
+      size_t copies = 0;
+      stream_t stream;
+      moving_observer o1, o2, o3;
+      stream.subscribe( o1 );
+      stream.subscribe( o2 );
+      stream.subscribe( o3 );
+
+      stream << copy_counter( copies );
+
+      // o1 and o2 copy the received reference into their member, o3 moves
+      CHECK( copies == 2 );
+      CHECK( o3.received.copies == &copies );
+    }
+  }
+
+
+  TEST_CASE( "Concurrent access (copy on write basic_stream)" )
+  {
+    struct counting_observer : basic_observer < int, access_policy::copy_on_write >
+    {
+      void on_event( int& ) final { ++count; }
+      void on_done() final {}
+
+      std::atomic< size_t > count{ 0 };
+    };
+
+    using stream_t = basic_stream< int, access_policy::copy_on_write >;
+
+    SECTION( "Dispatching concurrently while observers subscribe and unsubscribe" )
+    {
+      stream_t stream;
+      counting_observer permanent;
+      stream.subscribe( permanent );
+
+      auto transient = std::vector< counting_observer >( 4 );
+
+      const size_t producerCount = 4;
+      const size_t eventsPerProducer = 10000;
+
+      auto tasks = std::vector< std::future< void > >();
+      for( size_t i = 0; i < producerCount; ++i )
+      {
+        tasks.push_back( std::async(
+          std::launch::async,
+          [&stream]()
+          {
+            for( size_t j = 0; j < eventsPerProducer; ++j )
+              stream << static_cast< int >( j );
+          }
+        ));
+      }
+      for( auto& o : transient )
+      {
+        tasks.push_back( std::async(
+          std::launch::async,
+          [&o, &stream]()
+          {
+            for( size_t j = 0; j < 200; ++j )
+            {
+              stream.subscribe( o );
+              stream.unsubscribe( o );
+            }
+          }
+        ));
+      }
+      tasks.clear();
+
+      CHECK( permanent.count == producerCount * eventsPerProducer );
+      CHECK( stream.get_observer_count() == 1 );
+    }
+  }
+
+
+  template< typename access_policy_t >
+  void dispatch_concurrently( size_t producerCount_, size_t eventsPerProducer_ )
+  {
+    struct counting_observer : basic_observer < int, access_policy_t >
+    {
+      void on_event( int& ) final { ++count; }
+      void on_done() final {}
+
+      std::atomic< size_t > count{ 0 };
+    };
+
+    basic_stream< int, access_policy_t > stream;
+    auto observers = std::vector< counting_observer >( 3 );
+    for( auto& o : observers )
+      stream.subscribe( o );
+
+    auto tasks = std::vector< std::future< void > >();
+    for( size_t i = 0; i < producerCount_; ++i )
+    {
+      tasks.push_back( std::async(
+        std::launch::async,
+        [&stream, eventsPerProducer_]()
+        {
+          for( size_t j = 0; j < eventsPerProducer_; ++j )
+            stream << static_cast< int >( j );
+        }
+      ));
+    }
+    tasks.clear();
+
+    for( auto& o : observers )
+      CHECK( o.count == producerCount_ * eventsPerProducer_ );
+  }
+
+  TEST_CASE( "Concurrent access (spinning and shared locked basic_stream)" )
+  {
+    SECTION( "Send messages concurrently (spinning)" )
+    {
+      dispatch_concurrently< access_policy::spinning >( 8, 10000 );
+    }
+
+    SECTION( "Send messages concurrently (shared locked)" )
+    {
+      dispatch_concurrently< access_policy::shared_locked >( 8, 10000 );
+    }
+  }
+
+  TEST_CASE( "Parallel dispatch" )
+  {
+    struct recording_observer : basic_observer< int, access_policy::none >
+    {
+      void on_event( int& v_ ) final
+      {
+        values.push_back( v_ );
+        threads.insert( std::this_thread::get_id() );
+      }
+      void on_done() final {}
+
+      std::vector< int > values;
+      std::set< std::thread::id > threads;
+    };
+
+    using stream_t = basic_stream< int, access_policy::none >;
+
+    fork_join_pool pool( 3 );
+    std::vector< recording_observer > observers( 16 );
+
+    SECTION( "Every observer receives all events in order" )
+    {
+      stream_t stream;
+      stream.set_parallel_dispatch( &pool );
+      for( auto& o : observers )
+        stream.subscribe( o );
+
+      for( int i = 0; i < 100; ++i )
+        stream << i;
+
+      std::set< std::thread::id > threads;
+      for( auto& o : observers )
+      {
+        REQUIRE( o.values.size() == 100 );
+        for( int i = 0; i < 100; ++i )
+          CHECK( o.values[i] == i );
+        threads.insert( o.threads.begin(), o.threads.end() );
+      }
+      CHECK( threads.size() <= pool.concurrency() );
+    }
+
+    SECTION( "Batches are dispatched in parallel, too" )
+    {
+      stream_t stream;
+      stream.set_parallel_dispatch( &pool );
+      for( auto& o : observers )
+        stream.subscribe( o );
+
+      std::vector< int > batch = { 1, 2, 3 };
+      stream.push_events( batch );
+
+      for( auto& o : observers )
+        CHECK( o.values == batch );
+    }
+
+    SECTION( "Below the threshold events are dispatched on the pushing thread" )
+    {
+      stream_t stream;
+      stream.set_parallel_dispatch( &pool, 4 );
+      stream.subscribe( observers[0] );
+      stream.subscribe( observers[1] );
+
+      stream << 1;
+
+      CHECK( observers[0].threads == std::set< std::thread::id >{ std::this_thread::get_id() } );
+      CHECK( observers[1].threads == std::set< std::thread::id >{ std::this_thread::get_id() } );
+    }
+
+    SECTION( "A slow observer holds up unsubscribing it, but not subscribing others" )
+    {
+      struct blocking_observer : basic_observer< int, access_policy::locked >
+      {
+        void on_event( int& ) final
+        {
+          entered = true;
+          while( !released )
+            std::this_thread::yield();
+        }
+        void on_done() final {}
+
+        std::atomic< bool > entered{ false };
+        std::atomic< bool > released{ false };
+      };
+
+      struct counting_observer : basic_observer< int, access_policy::locked >
+      {
+        void on_event( int& ) final { ++count; }
+        void on_done() final {}
+
+        std::atomic< int > count{ 0 };
+      };
+
+      basic_stream< int, access_policy::locked > stream;
+      stream.set_parallel_dispatch( &pool );
+      blocking_observer slow;
+      counting_observer fast, late;
+      stream.subscribe( slow );
+      stream.subscribe( fast );
+
+      auto pusher = std::async( std::launch::async, [&stream]() { stream << 1; } );
+      while( !slow.entered )
+        std::this_thread::yield();
+
+      stream.subscribe( late );
+      CHECK( stream.get_observer_count() == 3 );
+
+      auto unsubscriber = std::async( std::launch::async, [&stream, &slow]() { stream.unsubscribe( slow ); } );
+      CHECK( unsubscriber.wait_for( std::chrono::milliseconds( 20 ) ) == std::future_status::timeout );
+
+      slow.released = true;
+      pusher.get();
+      unsubscriber.get();
+      CHECK( stream.get_observer_count() == 2 );
+      CHECK( fast.count == 1 );
+      CHECK( late.count == 0 );
+    }
+  }
 }
 }
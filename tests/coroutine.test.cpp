@@ -0,0 +1,209 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/coroutine.h>
+#include <mvd/streams/basic_stream.h>
+#include <mvd/streams/spsc_queue.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  namespace
+  {
+    template< typename observer_t >
+    detached_task collect( observer_t& o_, std::vector< int >& received_, bool& finished_ )
+    {
+      while( auto e = co_await o_.next() )
+        received_.push_back( *e );
+      finished_ = true;
+    }
+
+    // coroutine lambdas must not capture, the closure is gone once the coroutine suspends
+    template< typename observer_t >
+    detached_task sum_up( observer_t& o_, int& sum_ )
+    {
+      while( auto e = co_await o_.next() )
+        sum_ += *e;
+    }
+
+    template< typename observer_t >
+    detached_task record_thread( observer_t& o_, std::thread::id& resumedOn_ )
+    {
+      co_await o_.next();
+      resumedOn_ = std::this_thread::get_id();
+    }
+
+    template< typename stream_t, typename observer_t >
+    detached_task unsubscribe_after_first( stream_t& s_, observer_t& o_, std::vector< int >& received_ )
+    {
+      if( auto e = co_await o_.next() )
+        received_.push_back( *e );
+      s_.unsubscribe( o_ );
+    }
+
+    // runs the scheduled runnables when asked to
+    class manual_executor : public executor
+    {
+    public:
+
+      void attach( runnable& ) override {}
+      void detach( runnable& ) override {}
+      void schedule( runnable& r_ ) override { m_scheduled.push_back( &r_ ); }
+
+      void run_scheduled()
+      {
+        auto scheduled = std::move( m_scheduled );
+        for( auto r : scheduled )
+          r->run();
+      }
+
+    private:
+
+      std::vector< runnable* > m_scheduled;
+    };
+  }
+
+
+  TEST_CASE( "coroutine_observer" )
+  {
+    using stream_t = basic_stream< int, access_policy::none >;
+    using observer_t = coroutine_observer< int, access_policy::none >;
+
+    SECTION( "A waiting consumer is resumed on push" )
+    {
+      stream_t s;
+      observer_t o( 4u );
+      s.subscribe( o );
+
+      auto received = std::vector< int >();
+      bool finished = false;
+      collect( o, received, finished );
+      CHECK( received.empty() );
+
+      s << 1;
+      CHECK( received == std::vector< int >{ 1 } );
+      s << 2 << 3;
+      CHECK( received == std::vector< int >{ 1, 2, 3 } );
+      CHECK( !finished );
+
+      s.on_done();
+      CHECK( finished );
+    }
+
+    SECTION( "Events pushed before the consumer awaits are queued" )
+    {
+      stream_t s;
+      observer_t o( 4u );
+      s.subscribe( o );
+
+      s << 1 << 2;
+      s.on_done();
+
+      auto received = std::vector< int >();
+      bool finished = false;
+      collect( o, received, finished );
+
+      CHECK( received == std::vector< int >{ 1, 2 } );
+      CHECK( finished );
+    }
+
+    SECTION( "Consumers are resumed on the pushing thread" )
+    {
+      using locked_stream_t = basic_stream< int, access_policy::locked >;
+      locked_stream_t s;
+      coroutine_observer< int, access_policy::locked, spsc_queue > o( 4u );
+      s.subscribe( o );
+
+      auto resumedOn = std::thread::id();
+      record_thread( o, resumedOn );
+
+      auto pusher = std::thread( [&s]() { s << 1; } );
+      auto pusherId = pusher.get_id();
+      pusher.join();
+
+      CHECK( resumedOn == pusherId );
+    }
+
+    SECTION( "Many consumers don't need a thread each" )
+    {
+      stream_t s;
+      auto observers = std::vector< std::unique_ptr< observer_t > >();
+      auto sums = std::vector< int >( 1000, 0 );
+
+      for( size_t i = 0; i < sums.size(); ++i )
+      {
+        observers.push_back( std::make_unique< observer_t >( 4u ) );
+        s.subscribe( *observers[i] );
+        sum_up( *observers[i], sums[i] );
+      }
+
+      s << 1 << 2 << 3;
+      s.on_done();
+
+      for( auto sum : sums )
+        CHECK( sum == 6 );
+    }
+
+    SECTION( "The queue is bounded by the overflow policy" )
+    {
+      stream_t s;
+      observer_t o( 2u );
+      s.subscribe( o );
+
+      s << 1 << 2 << 3;
+      s.on_done();
+      CHECK( o.get_overflow_statistics().dropped() == 1 );
+
+      auto received = std::vector< int >();
+      bool finished = false;
+      collect( o, received, finished );
+      CHECK( received == std::vector< int >{ 1, 2 } );
+      CHECK( finished );
+    }
+
+    SECTION( "With an executor, consumers are resumed after the push returned" )
+    {
+      using locked_stream_t = basic_stream< int, access_policy::locked >;
+      locked_stream_t s;
+      coroutine_observer< int, access_policy::locked > o( 4u );
+      manual_executor e;
+      o.set_executor( &e );
+      s.subscribe( o );
+
+      auto received = std::vector< int >();
+      unsubscribe_after_first( s, o, received );
+
+      // resuming inline would unsubscribe while the stream holds its observer list lock
+      s << 1;
+      CHECK( received.empty() );
+
+      e.run_scheduled();
+      CHECK( received == std::vector< int >{ 1 } );
+      CHECK( s.get_observer_count() == 0 );
+    }
+  }
+
+}
+}
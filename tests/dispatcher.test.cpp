@@ -0,0 +1,206 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/basic_async_stream.h>
+#include <mvd/streams/dispatcher.h>
+#include <mvd/streams/mpsc_queue.h>
+#include <mvd/streams/spsc_queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace mvd
+{
+namespace streams
+{
+  namespace
+  {
+    struct counting_observer : basic_observer< int, access_policy::none >
+    {
+      void on_event( int& v_ ) final
+      {
+        sum += v_;
+        lastThread = std::this_thread::get_id();
+        count.fetch_add( 1 );
+      }
+      void on_done() final {}
+
+      int sum = 0;
+      std::thread::id lastThread;
+      std::atomic< size_t > count{ 0 };
+    };
+
+    bool wait_for_count( const counting_observer& o_, size_t count_ )
+    {
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+      while( o_.count.load() < count_ )
+      {
+        if( std::chrono::steady_clock::now() > deadline )
+          return false;
+        std::this_thread::yield();
+      }
+      return true;
+    }
+
+    struct counting_runnable : runnable
+    {
+      void run() final { count.fetch_add( 1 ); }
+
+      std::atomic< size_t > count{ 0 };
+    };
+
+    bool wait_for_count( const counting_runnable& r_, size_t count_ )
+    {
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+      while( r_.count.load() < count_ )
+      {
+        if( std::chrono::steady_clock::now() > deadline )
+          return false;
+        std::this_thread::yield();
+      }
+      return true;
+    }
+  }
+
+
+  TEST_CASE( "dispatcher" )
+  {
+    using stream_t = basic_async_stream< int, access_policy::none, spsc_queue >;
+
+    SECTION( "Pushed events are dispatched on the dispatcher thread" )
+    {
+      dispatcher d;
+      stream_t s( 64u );
+      counting_observer o;
+      s.subscribe( o );
+      s.set_executor( &d );
+
+      for( int i = 1; i <= 10; ++i )
+        s << i;
+
+      REQUIRE( wait_for_count( o, 10 ) );
+      CHECK( o.sum == 55 );
+      CHECK( o.lastThread != std::this_thread::get_id() );
+    }
+
+    SECTION( "A parked dispatcher is woken up by a push" )
+    {
+      dispatcher d( 0 );
+      stream_t s( 64u );
+      counting_observer o;
+      s.subscribe( o );
+      s.set_executor( &d );
+
+      s << 1;
+      REQUIRE( wait_for_count( o, 1 ) );
+
+      std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+      s << 2;
+      REQUIRE( wait_for_count( o, 2 ) );
+      CHECK( o.sum == 3 );
+    }
+
+    SECTION( "One dispatcher serves several streams" )
+    {
+      dispatcher d;
+      basic_async_stream< int, access_policy::none, mpsc_queue > s1( 64u ), s2( 64u );
+      counting_observer o1, o2;
+      s1.subscribe( o1 );
+      s2.subscribe( o2 );
+      s1.set_executor( &d );
+      s2.set_executor( &d );
+
+      s1 << 1;
+      s2 << 2;
+
+      REQUIRE( wait_for_count( o1, 1 ) );
+      REQUIRE( wait_for_count( o2, 1 ) );
+    }
+
+    SECTION( "Stopping the dispatcher runs the pending work" )
+    {
+      counting_observer o;
+      stream_t s( 64u );
+      s.subscribe( o );
+      {
+        dispatcher d;
+        s.set_executor( &d );
+        s << 1 << 2;
+        d.stop();
+        s.set_executor( nullptr );
+      }
+      CHECK( o.count == 2 );
+    }
+
+    SECTION( "Destroyed streams are detached" )
+    {
+      dispatcher d;
+      counting_observer o;
+      {
+        auto s = std::make_unique< stream_t >( 64u );
+        s->subscribe( o );
+        s->set_executor( &d );
+        *s << 1;
+      }
+      d.stop();
+      CHECK( o.count <= 1 );
+    }
+
+    SECTION( "Only scheduled runnables are run" )
+    {
+      dispatcher d;
+      counting_runnable busy, idle;
+      d.attach( busy );
+      d.attach( idle );
+
+      // attaching schedules each of them once
+      REQUIRE( wait_for_count( busy, 1 ) );
+      REQUIRE( wait_for_count( idle, 1 ) );
+
+      for( size_t i = 2; i <= 100; ++i )
+      {
+        d.schedule( busy );
+        REQUIRE( wait_for_count( busy, i ) );
+      }
+
+      d.detach( busy );
+      d.detach( idle );
+      CHECK( idle.count == 1 );
+    }
+
+    SECTION( "A moved stream stays attached" )
+    {
+      dispatcher d;
+      stream_t s1( 64u );
+      s1.set_executor( &d );
+
+      stream_t s2 = std::move( s1 );
+      counting_observer o;
+      s2.subscribe( o );
+
+      s2 << 1;
+      REQUIRE( wait_for_count( o, 1 ) );
+    }
+  }
+
+}
+}
@@ -0,0 +1,185 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/double_buffered_queue.h>
+#include <mvd/streams/basic_async_stream.h>
+
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "double_buffered_queue" )
+  {
+    SECTION( "A batch contains all events pushed so far, in order" )
+    {
+      double_buffered_queue< int > q( 8u );
+      for( int i = 0; i < 5; ++i )
+        REQUIRE( q.push( i ) );
+      CHECK( q.size() == 5 );
+
+      std::vector< int > received;
+      auto count = q.consume_batch( [&received]( span< int > events_ )
+      {
+        received.insert( received.end(), events_.begin(), events_.end() );
+      });
+
+      CHECK( count == 5 );
+      CHECK( received == std::vector< int >{ 0, 1, 2, 3, 4 } );
+      CHECK( q.empty() );
+      CHECK( q.consume_batch( []( span< int > ) { FAIL(); } ) == 0 );
+    }
+
+    SECTION( "Push fails when the front buffer is full" )
+    {
+      double_buffered_queue< int > q( 4u );
+      for( int i = 0; i < 4; ++i )
+        CHECK( q.push( i ) );
+      CHECK( !q.push( 4 ) );
+
+      q.consume_batch( []( span< int > ) {} );
+      CHECK( q.push( 4 ) );
+    }
+
+    SECTION( "consume_one and consume_batch can be mixed" )
+    {
+      double_buffered_queue< int > q( 8u );
+      q.push( 1 );
+      q.push( 2 );
+
+      int e = 0;
+      REQUIRE( q.pop( e ) );
+      CHECK( e == 1 );
+
+      q.push( 3 );
+
+      std::vector< int > received;
+      auto count = q.consume_batch( [&received]( span< int > events_ )
+      {
+        received.insert( received.end(), events_.begin(), events_.end() );
+      });
+      CHECK( count == 2 );
+      CHECK( received == std::vector< int >{ 2, 3 } );
+      CHECK( !q.pop( e ) );
+    }
+
+    SECTION( "Events can be moved out of a batch" )
+    {
+      double_buffered_queue< std::unique_ptr< int > > q( 4u );
+      q.push( std::make_unique< int >( 42 ) );
+
+      std::unique_ptr< int > e;
+      q.consume_batch( [&e]( span< std::unique_ptr< int > > events_ ) { e = std::move( events_[0] ); } );
+      REQUIRE( e );
+      CHECK( *e == 42 );
+    }
+
+    SECTION( "Concurrent producers" )
+    {
+      const int producerCount = 4;
+      const int eventsPerProducer = 10000;
+      double_buffered_queue< int > q( 256u );
+
+      std::vector< std::future< void > > producers;
+      for( int p = 0; p < producerCount; ++p )
+      {
+        producers.push_back( std::async( std::launch::async, [&q, p, eventsPerProducer]()
+        {
+          for( int i = 0; i < eventsPerProducer; ++i )
+            while( !q.push( p * eventsPerProducer + i ) )
+              std::this_thread::yield();
+        }));
+      }
+
+      // events of each producer arrive in order
+      std::vector< int > next( producerCount, 0 );
+      int received = 0;
+      bool ordered = true;
+      while( received < producerCount * eventsPerProducer )
+      {
+        received += static_cast< int >( q.consume_batch( [&]( span< int > events_ )
+        {
+          for( auto e : events_ )
+          {
+            auto p = e / eventsPerProducer;
+            ordered = ordered && e % eventsPerProducer == next[p];
+            next[p] = e % eventsPerProducer + 1;
+          }
+        }));
+      }
+
+      for( auto& p : producers )
+        p.get();
+      CHECK( ordered );
+      CHECK( q.empty() );
+    }
+
+    SECTION( "Async observer processes whole batches" )
+    {
+      basic_stream< int, access_policy::none > s;
+      basic_async_observer< int, access_policy::none, double_buffered_queue > o( 16u );
+      s.subscribe( o );
+
+      s << 1 << 2 << 3;
+
+      size_t batches = 0;
+      int sum = 0;
+      CHECK( o.process_event_batch( [&]( span< int > events_ )
+      {
+        ++batches;
+        for( auto e : events_ )
+          sum += e;
+      }) == 3 );
+      CHECK( batches == 1 );
+      CHECK( sum == 6 );
+    }
+
+    SECTION( "Async stream dispatches a batch via on_events" )
+    {
+      struct batch_observer : basic_observer< int, access_policy::none >
+      {
+        void on_event( int& ) final { ++single; }
+        void on_events( span< int > events_ ) final { batches.push_back( events_.size() ); }
+        void on_done() final {}
+
+        int single = 0;
+        std::vector< size_t > batches;
+      };
+
+      basic_async_stream< int, access_policy::none, double_buffered_queue > s( 16u );
+      batch_observer o;
+      s.subscribe( o );
+
+      s << 1 << 2 << 3 << 4;
+      CHECK( s.dispatch_event_batch() == 4 );
+      CHECK( o.single == 0 );
+      CHECK( o.batches == std::vector< size_t >{ 4 } );
+
+      s << 5;
+      s.dispatch_events();
+      CHECK( o.single == 1 );
+    }
+  }
+}
+}
@@ -0,0 +1,90 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/fork_join_pool.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "fork_join_pool" )
+  {
+    SECTION( "Every iteration runs exactly once" )
+    {
+      fork_join_pool pool( 3 );
+      CHECK( pool.concurrency() == 4 );
+
+      for( size_t count : { 0u, 1u, 2u, 7u, 1000u } )
+      {
+        std::vector< std::atomic< int > > calls( count );
+        for( auto& c : calls )
+          c.store( 0 );
+
+        pool.parallel_for( count, [&calls]( size_t i_ ) { calls[ i_ ].fetch_add( 1 ); } );
+
+        for( auto& c : calls )
+          CHECK( c.load() == 1 );
+      }
+    }
+
+    SECTION( "A pool without threads runs the loop on the calling thread" )
+    {
+      fork_join_pool pool( 0 );
+      std::vector< std::thread::id > threads( 10 );
+      pool.parallel_for( threads.size(), [&threads]( size_t i_ ) { threads[ i_ ] = std::this_thread::get_id(); } );
+
+      for( auto& t : threads )
+        CHECK( t == std::this_thread::get_id() );
+    }
+
+    SECTION( "Nested loops run on the calling thread" )
+    {
+      fork_join_pool pool( 2 );
+      std::atomic< int > sum{ 0 };
+      pool.parallel_for( 8, [&]( size_t )
+      {
+        pool.parallel_for( 8, [&]( size_t i_ ) { sum.fetch_add( static_cast< int >( i_ ) ); } );
+      });
+      CHECK( sum == 8 * 28 );
+    }
+
+    SECTION( "Loops can be started from several threads at once" )
+    {
+      fork_join_pool pool( 2 );
+      std::atomic< int > sum{ 0 };
+
+      auto run = [&]()
+      {
+        for( int n = 0; n < 100; ++n )
+          pool.parallel_for( 10, [&sum]( size_t ) { sum.fetch_add( 1 ); } );
+      };
+      std::thread t1( run ), t2( run );
+      t1.join();
+      t2.join();
+
+      CHECK( sum == 2 * 100 * 10 );
+    }
+  }
+}
+}
@@ -0,0 +1,120 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/inline_function.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "inline_function" )
+  {
+    SECTION( "Invokes a stored lambda" )
+    {
+      int sum = 0;
+      inline_function< void( int& ) > f = [&sum]( int& i ) { sum += i; };
+
+      int i = 3;
+      f( i );
+      f( i );
+      CHECK( sum == 6 );
+    }
+
+    SECTION( "Is empty when default constructed or reset" )
+    {
+      inline_function< void() > f;
+      CHECK( !f );
+
+      f = []() {};
+      CHECK( f );
+
+      f = nullptr;
+      CHECK( !f );
+    }
+
+    SECTION( "Can hold move-only callables" )
+    {
+      auto p = std::make_unique< int >( 42 );
+      inline_function< int() > f = [p = std::move( p )]() { return *p; };
+
+      auto g = std::move( f );
+      CHECK( !f );
+      REQUIRE( g );
+      CHECK( g() == 42 );
+    }
+
+    SECTION( "Stores callables that exceed the inline capacity on the heap" )
+    {
+      std::string s( 100, 'x' );
+      inline_function< size_t(), 16 > f = [s]() { return s.size(); };
+
+      auto g = std::move( f );
+      CHECK( g() == 100 );
+    }
+
+    SECTION( "Destroys the stored callable" )
+    {
+      auto p = std::make_shared< int >( 0 );
+      {
+        inline_function< void() > f = [p]() {};
+        CHECK( p.use_count() == 2 );
+      }
+      CHECK( p.use_count() == 1 );
+    }
+  }
+
+
+  TEST_CASE( "copyable_inline_function" )
+  {
+    SECTION( "Copies duplicate the stored callable" )
+    {
+      int calls = 0;
+      copyable_inline_function< bool( const int& ) > f = [&calls]( const int& i ) { ++calls; return i > 0; };
+
+      auto g = f;
+      CHECK( f( 1 ) );
+      CHECK( !g( -1 ) );
+      CHECK( calls == 2 );
+    }
+
+    SECTION( "Copies of heap stored callables are independent" )
+    {
+      std::string s( 100, 'x' );
+      copyable_inline_function< size_t(), 16 > f = [s]() { return s.size(); };
+
+      auto g = f;
+      f = nullptr;
+      CHECK( g() == 100 );
+    }
+
+    SECTION( "Can wrap a std::function" )
+    {
+      std::function< int( const int& ) > sf = []( const int& i ) { return i * 2; };
+      copyable_inline_function< int( const int& ) > f = sf;
+      CHECK( f( 21 ) == 42 );
+    }
+  }
+
+}
+}
@@ -0,0 +1,168 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/mpsc_queue.h>
+#include <mvd/streams/basic_async_stream.h>
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "mpsc_queue" )
+  {
+    SECTION( "Events are popped in FIFO order across the end of the buffer" )
+    {
+      mpsc_queue< int > q( 4u );
+      int e = 0;
+
+      for( int i = 0; i < 10; ++i )
+      {
+        REQUIRE( q.push( i ) );
+        REQUIRE( q.push( i + 100 ) );
+        REQUIRE( q.pop( e ) );
+        CHECK( e == i );
+        REQUIRE( q.pop( e ) );
+        CHECK( e == i + 100 );
+      }
+      CHECK( !q.pop( e ) );
+    }
+
+    SECTION( "Push fails when the queue is full" )
+    {
+      mpsc_queue< int > q( 4u );
+      for( int i = 0; i < 4; ++i )
+        CHECK( q.push( i ) );
+      CHECK( !q.push( 4 ) );
+
+      int e = 0;
+      q.pop( e );
+      CHECK( q.push( 4 ) );
+    }
+
+    SECTION( "Queues of capacity 0 and 1 get two slots" )
+    {
+      for( size_t capacity : { size_t( 0 ), size_t( 1 ) } )
+      {
+        mpsc_queue< std::string > q( capacity );
+        CHECK( q.push( "a" ) );
+        CHECK( q.push( "b" ) );
+        CHECK( !q.push( "c" ) );
+        CHECK( q.size() == 2 );
+
+        std::string e;
+        REQUIRE( q.pop( e ) );
+        CHECK( e == "a" );
+        CHECK( q.push( "c" ) );
+        REQUIRE( q.pop( e ) );
+        CHECK( e == "b" );
+        REQUIRE( q.pop( e ) );
+        CHECK( e == "c" );
+        CHECK( !q.pop( e ) );
+      }
+    }
+
+    SECTION( "Queued events are destroyed with the queue" )
+    {
+      auto p = std::make_shared< int >( 0 );
+      {
+        mpsc_queue< std::shared_ptr< int > > q( 4u );
+        q.push( p );
+        auto moved = std::move( q );
+        CHECK( p.use_count() == 2 );
+      }
+      CHECK( p.use_count() == 1 );
+    }
+
+    SECTION( "Events of concurrent producers all arrive, each producer's in order" )
+    {
+      const size_t producerCount = 8;
+      const size_t eventsPerProducer = 20000;
+      mpsc_queue< std::pair< size_t, size_t > > q( 256u );
+
+      auto producers = std::vector< std::future< void > >();
+      for( size_t p = 0; p < producerCount; ++p )
+      {
+        producers.push_back( std::async( std::launch::async, [&q, p]()
+        {
+          for( size_t i = 0; i < eventsPerProducer; ++i )
+            while( !q.push( std::make_pair( p, i ) ) ) {}
+        }));
+      }
+
+      auto next = std::vector< size_t >( producerCount, 0 );
+      size_t received = 0;
+      bool inOrder = true;
+      while( received < producerCount * eventsPerProducer )
+      {
+        q.consume_one( [&]( std::pair< size_t, size_t >& e_ )
+        {
+          inOrder = inOrder && e_.second == next[ e_.first ]++;
+          ++received;
+        });
+      }
+      producers.clear();
+
+      CHECK( inOrder );
+      for( auto n : next )
+        CHECK( n == eventsPerProducer );
+    }
+  }
+
+
+  TEST_CASE( "basic_async_stream (mpsc queue)" )
+  {
+    struct counting_observer : basic_observer< int, access_policy::none >
+    {
+      void on_event( int& ) final { ++count; }
+      void on_done() final {}
+
+      size_t count = 0;
+    };
+
+    SECTION( "Events pushed from several threads are dispatched on request" )
+    {
+      basic_async_stream< int, access_policy::none, mpsc_queue > stream( 4096u );
+      counting_observer o;
+      stream.subscribe( o );
+
+      auto producers = std::vector< std::future< void > >();
+      for( size_t p = 0; p < 4; ++p )
+      {
+        producers.push_back( std::async( std::launch::async, [&stream]()
+        {
+          for( int i = 0; i < 1000; ++i )
+            stream << i;
+        }));
+      }
+      producers.clear();
+
+      CHECK( o.count == 0 );
+      stream.dispatch_events();
+      CHECK( o.count == 4000 );
+    }
+  }
+
+}
+}
@@ -0,0 +1,150 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/basic_async_stream.h>
+#include <mvd/streams/dispatcher.h>
+#include <mvd/streams/object_pool.h>
+#include <mvd/streams/spsc_queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "object_pool" )
+  {
+    struct payload
+    {
+      std::vector< int > values;
+    };
+
+    object_pool< payload > pool( 4 );
+
+    SECTION( "Released objects are recycled" )
+    {
+      auto p = pool.acquire();
+      auto object = p.get();
+      p->values.assign( 100, 1 );
+      CHECK( pool.acquired() == 1 );
+
+      p.reset();
+      CHECK_FALSE( p );
+      CHECK( pool.acquired() == 0 );
+
+      auto q = pool.acquire();
+      CHECK( q.get() == object );
+      CHECK( q->values.capacity() >= 100 );
+      CHECK( pool.capacity() == 4 );
+    }
+
+    SECTION( "Copies share the object, it is released with the last one" )
+    {
+      auto p = pool.acquire();
+      auto copy = p;
+      CHECK( p.use_count() == 2 );
+      CHECK( copy.get() == p.get() );
+
+      auto moved = std::move( copy );
+      CHECK_FALSE( copy );
+      CHECK( p.use_count() == 2 );
+
+      p.reset();
+      CHECK( pool.acquired() == 1 );
+      moved.reset();
+      CHECK( pool.acquired() == 0 );
+    }
+
+    SECTION( "The pool grows by a chunk when it runs empty" )
+    {
+      std::vector< pooled_ptr< payload > > handles;
+      for( int i = 0; i < 5; ++i )
+        handles.push_back( pool.acquire() );
+      CHECK( pool.capacity() == 8 );
+
+      pool.reserve( 10 );
+      CHECK( pool.capacity() == 12 );
+    }
+
+    SECTION( "Objects released on another thread go back to the pool" )
+    {
+      std::vector< pooled_ptr< payload > > handles;
+      for( int i = 0; i < 4; ++i )
+        handles.push_back( pool.acquire() );
+
+      std::thread( [&handles]() { handles.clear(); } ).join();
+      CHECK( pool.acquired() == 0 );
+
+      for( int i = 0; i < 4; ++i )
+        handles.push_back( pool.acquire() );
+      CHECK( pool.capacity() == 4 );
+      handles.clear();
+    }
+
+    SECTION( "Handles flow through an async stream" )
+    {
+      struct sum_observer : basic_observer< pooled_ptr< payload >, access_policy::none >
+      {
+        void on_event( pooled_ptr< payload >& p_ ) final
+        {
+          for( auto v : p_->values )
+            sum += v;
+          count.fetch_add( 1 );
+        }
+        void on_done() final {}
+
+        long sum = 0;
+        std::atomic< int > count{ 0 };
+      };
+
+      const int eventCount = 1000;
+      sum_observer o;
+      dispatcher d;
+      {
+        basic_async_stream< pooled_ptr< payload >, access_policy::none, spsc_queue > s( 64u );
+        s.set_overflow_policy( overflow_policy< pooled_ptr< payload > >::block( std::chrono::seconds( 10 ) ) );
+        s.subscribe( o );
+        s.set_executor( &d );
+
+        for( int i = 0; i < eventCount; ++i )
+        {
+          auto p = pool.acquire();
+          p->values.assign( 10, 1 );
+          s << std::move( p );
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+        while( o.count < eventCount && std::chrono::steady_clock::now() < deadline )
+          std::this_thread::yield();
+        s.set_executor( nullptr );
+      }
+
+      CHECK( o.sum == 10 * eventCount );
+      CHECK( pool.acquired() == 0 );
+
+      // the queue holds at most 64 handles, plus the ones being pushed and dispatched
+      CHECK( pool.capacity() <= 80 );
+    }
+  }
+}
+}
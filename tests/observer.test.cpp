@@ -24,7 +24,9 @@
 #include <boost/predef.h>
 
 #include <future>
+#include <memory>
 #include <random>
+#include <vector>
 
 namespace mvd
 {
@@ -166,6 +168,67 @@ namespace streams
   }
 
 
+  TEST_CASE( "observable_base (copy on write)" )
+  {
+    using observer_t = observer_base < access_policy::copy_on_write >;
+    using observable_t = observable_base < access_policy::copy_on_write >;
+
+    SECTION( "Registering and unregistering observers updates registered count" )
+    {
+      observer_t o1, o2;
+      observable_t observable;
+
+      observable.register_observer(o1);
+      observable.register_observer(o2);
+      REQUIRE( observable.get_observer_count() == 2 );
+
+      observable.unregister_observer(o1);
+      CHECK( observable.get_observer_count() == 1 );
+      CHECK( o1.is_observing() == false );
+      CHECK( o2.is_observing() );
+    }
+
+    SECTION( "Many registrations retire and reclaim snapshots" )
+    {
+      auto observers = std::vector< observer_t >( 100 );
+      observable_t observable;
+
+      for( auto& o : observers )
+        observable.register_observer( o );
+      REQUIRE( observable.get_observer_count() == observers.size() );
+
+      for( auto& o : observers )
+        observable.unregister_observer( o );
+      CHECK( observable.get_observer_count() == 0 );
+    }
+
+    SECTION( "Concurrent subscription / unsubscription" )
+    {
+      auto observers = std::vector< observer_t >( 20 );
+      observable_t observable;
+
+      auto tasks = std::vector< std::future< void > >();
+      for( auto& o : observers )
+      {
+        tasks.push_back( std::async(
+          std::launch::async,
+          [&o, &observable]()
+          {
+            for( size_t i = 0; i < 1000; ++i )
+            {
+              observable.register_observer( o );
+              observable.unregister_observer( o );
+            }
+          }
+        ));
+      }
+      tasks.clear();
+
+      CHECK( observable.get_observer_count() == 0 );
+    }
+  }
+
+
   TEST_CASE( "observer_base" )
   {
     using observer_t = observer_base < access_policy::none >;
@@ -255,5 +318,187 @@ namespace streams
       CHECK( observable.get_observer_count() == 0 );
     }
   }
+
+
+  TEST_CASE( "observer_list" )
+  {
+    using observer_t = observer_base < access_policy::none >;
+    using list_t = observer_list< observer_t, access_policy::none >;
+
+    auto visit = []( list_t& l_ )
+    {
+      auto visited = std::vector< observer_t* >();
+      l_.for_each( [&visited]( observer_t& o_ ) { visited.push_back( &o_ ); } );
+      return visited;
+    };
+
+    SECTION( "Removing an observer keeps the order of the others" )
+    {
+      auto observers = std::vector< observer_t >( 5 );
+      list_t l;
+      for( auto& o : observers )
+        l.add( &o );
+
+      CHECK( l.remove( &observers[2] ) );
+      CHECK( l.remove( &observers[0] ) );
+      CHECK( l.remove( &observers[4] ) );
+
+      CHECK( l.size() == 2 );
+      CHECK( visit( l ) == std::vector< observer_t* >{ &observers[1], &observers[3] } );
+    }
+
+    SECTION( "Removing an observer that is in another list has no effect" )
+    {
+      observer_t o1, o2;
+      list_t l1, l2;
+      l1.add( &o1 );
+      l2.add( &o2 );
+
+      CHECK( !l1.remove( &o2 ) );
+      CHECK( l1.size() == 1 );
+      CHECK( l2.size() == 1 );
+    }
+
+    SECTION( "Removed observers can be added again" )
+    {
+      observer_t o1, o2;
+      list_t l;
+      l.add( &o1 );
+      l.add( &o2 );
+      l.remove( &o1 );
+      l.add( &o1 );
+
+      CHECK( visit( l ) == std::vector< observer_t* >{ &o2, &o1 } );
+    }
+
+    SECTION( "Snapshots are rebuilt after the list changes" )
+    {
+      auto snapshot = []( list_t& l_ )
+      {
+        auto observers = std::vector< observer_t* >();
+        l_.with_snapshot( [&observers]( observer_t* const* o_, size_t n_ ) { observers.assign( o_, o_ + n_ ); } );
+        return observers;
+      };
+
+      observer_t o1, o2;
+      list_t l;
+      l.add( &o1 );
+      l.add( &o2 );
+      CHECK( snapshot( l ) == std::vector< observer_t* >{ &o1, &o2 } );
+      CHECK( snapshot( l ) == std::vector< observer_t* >{ &o1, &o2 } );
+
+      l.remove( &o1 );
+      CHECK( snapshot( l ) == std::vector< observer_t* >{ &o2 } );
+
+      l.add( &o1 );
+      CHECK( snapshot( l ) == std::vector< observer_t* >{ &o2, &o1 } );
+
+      l.clear( []( observer_t& ) {} );
+      CHECK( snapshot( l ).empty() );
+    }
+  }
+
+
+  TEST_CASE( "scoped_subscription" )
+  {
+    using observer_t = observer_base < access_policy::none >;
+    using observable_t = observable_base < access_policy::none >;
+    using subscription_t = scoped_subscription< access_policy::none >;
+
+    SECTION( "Unregisters the observer when destroyed" )
+    {
+      observer_t o;
+      observable_t observable;
+      {
+        subscription_t s( observable, o );
+        CHECK( observable.get_observer_count() == 1 );
+      }
+      CHECK( observable.get_observer_count() == 0 );
+      CHECK( o.is_observing() == false );
+    }
+
+    SECTION( "Moving the handle transfers the subscription" )
+    {
+      observer_t o;
+      observable_t observable;
+      subscription_t s2;
+      {
+        subscription_t s1( observable, o );
+        s2 = std::move( s1 );
+        CHECK( !s1 );
+      }
+      CHECK( observable.get_observer_count() == 1 );
+
+      s2.reset();
+      CHECK( observable.get_observer_count() == 0 );
+    }
+
+    SECTION( "Released subscriptions outlive the handle" )
+    {
+      observer_t o;
+      observable_t observable;
+      {
+        subscription_t s( observable, o );
+        s.release();
+      }
+      CHECK( observable.get_observer_count() == 1 );
+    }
+
+    SECTION( "Can outlive the observable" )
+    {
+      observer_t o;
+      auto observable = std::make_unique< observable_t >();
+
+      subscription_t s( *observable, o );
+      observable.reset();
+      CHECK( o.is_observing() == false );
+    }
+
+    SECTION( "Doesn't unsubscribe an observer that moved to another observable" )
+    {
+      observer_t o;
+      observable_t observable1, observable2;
+      {
+        subscription_t s( observable1, o );
+        observable2.register_observer( o );
+      }
+      CHECK( observable2.get_observer_count() == 1 );
+    }
+
+    SECTION( "Can outlive the observer" )
+    {
+      observable_t observable;
+      auto o = std::make_unique< observer_t >();
+
+      subscription_t s( observable, *o );
+      o.reset();
+      CHECK( !s );
+      CHECK( observable.get_observer_count() == 0 );
+      s.reset();
+    }
+
+    SECTION( "Can outlive the observer after the observable" )
+    {
+      auto observable = std::make_unique< observable_t >();
+      auto o = std::make_unique< observer_t >();
+
+      subscription_t s( *observable, *o );
+      observable.reset();
+      o.reset();
+      CHECK( !s );
+    }
+
+    SECTION( "Subscribing again replaces the handle" )
+    {
+      observer_t o;
+      observable_t observable;
+      subscription_t s1( observable, o );
+      subscription_t s2( observable, o );
+      CHECK( !s1 );
+
+      s2.reset();
+      CHECK( observable.get_observer_count() == 0 );
+    }
+  }
 }
 }
@@ -61,6 +61,38 @@ namespace streams
       CHECK( o.values == expectedValues );
     }
   
+    SECTION( "Observer to filtered basic_stream receives filtered batches" )
+    {
+      stream_t s;
+      auto filtered = s && []( const int& i ) { return i%2 == 0; };
+      filter_observer o;
+      filtered.subscribe( o );
+
+      std::vector< int > values = { 1, 2, 3, 4, 15, 16, 100 };
+      s.push_events( values );
+
+      CHECK( o.values == std::vector< int >{ 2, 4, 16, 100 } );
+    }
+
+    SECTION( "Chained filters each build their own batch" )
+    {
+      stream_t s;
+      auto even = s && []( const int& i ) { return i%2 == 0; };
+      auto byFour = even && []( const int& i ) { return i%4 == 0; };
+      filter_observer o1, o2;
+      even.subscribe( o1 );
+      byFour.subscribe( o2 );
+
+      for( int i = 0; i < 2; ++i )
+      {
+        std::vector< int > values = { 1, 2, 3, 4, 8, 10, 12 };
+        s.push_events( values );
+      }
+
+      CHECK( o1.values == std::vector< int >{ 2, 4, 8, 10, 12, 2, 4, 8, 10, 12 } );
+      CHECK( o2.values == std::vector< int >{ 4, 8, 12, 4, 8, 12 } );
+    }
+
     SECTION( "Copying a filtered basic_stream duplicates the filter" )
     {
       stream_t s;
@@ -252,6 +284,24 @@ namespace streams
     }
     
     
+    SECTION( "Observer to merged basic_stream receives batches from both sources" )
+    {
+      stream_t s1;
+      stream_t s2;
+
+      auto merged = s1 || s2;
+      merge_observer o;
+      merged.subscribe( o );
+
+      std::vector< int > values1 = { 1, 2 };
+      std::vector< int > values2 = { 3, 4 };
+      s1.push_events( values1 );
+      s2.push_events( values2 );
+
+      CHECK( o.values == std::vector< int >{ 1, 2, 3, 4 } );
+    }
+
+
     SECTION( "Copyied merged basic_stream merges the same source streams" )
     {
       stream_t s1;
@@ -479,6 +529,37 @@ namespace streams
       CHECK( o.receivedValues == expectedValues );
     }
 
+    SECTION( "Observer to mapped basic_stream receives mapped batches" )
+    {
+      stream_t s;
+
+      auto mapped = s >> static_cast< std::function< std::string( const int& ) > >(
+        []( const int& i_ ) { return std::to_string( i_ ); }
+      );
+
+      map_observer o;
+      mapped.subscribe( o );
+
+      auto inputValues = std::vector< int >{ 1, 2, 4, 7, 11, 42 };
+      s.push_events( inputValues );
+
+      CHECK( o.receivedValues == std::vector< std::string >{ "1", "2", "4", "7", "11", "42" } );
+    }
+
+    SECTION( "Mapped event type is deduced from a plain lambda" )
+    {
+      stream_t s;
+
+      auto mapped = s >> []( const int& i_ ) { return std::to_string( i_ ); };
+      static_assert( std::is_same< decltype( mapped )::event_type, std::string >::value, "" );
+
+      map_observer o;
+      mapped.subscribe( o );
+
+      s << 7;
+      CHECK( o.receivedValues == std::vector< std::string >{ "7" } );
+    }
+
     SECTION( "Copyied mapped basic_stream merges the same source streams" )
     {
       stream_t s;
@@ -663,5 +744,152 @@ namespace streams
       }
     }
   }
+
+  TEST_CASE( "buffer and windows basic_stream" )
+  {
+    struct batch_observer : basic_observer< span< int >, access_policy::none >
+    {
+      void on_event( span< int >& v_ ) final
+      {
+        batches.emplace_back( v_.begin(), v_.end() );
+        data.push_back( v_.data() );
+      }
+      void on_done() final { ++onDoneCount; }
+
+      std::vector< std::vector< int > > batches;
+      std::vector< const int* > data;
+      int onDoneCount = 0;
+    };
+
+    using stream_t = basic_stream< int, access_policy::none >;
+    using out_stream_t = basic_stream< span< int >, access_policy::none >;
+    using batches_t = std::vector< std::vector< int > >;
+
+    batch_observer o;
+
+    SECTION( "buffer emits consecutive batches and flushes the last one on done" )
+    {
+      {
+        out_stream_t batched;
+        batched.subscribe( o );
+        {
+          stream_t s;
+          batched = buffer( s, 3 );
+
+          for( int i = 1; i <= 7; ++i )
+            s << i;
+          CHECK( o.batches == batches_t{ { 1, 2, 3 }, { 4, 5, 6 } } );
+
+          // the storage is reused
+          CHECK( o.data[0] == o.data[1] );
+        }
+        CHECK( o.batches == batches_t{ { 1, 2, 3 }, { 4, 5, 6 }, { 7 } } );
+        CHECK( o.onDoneCount == 0 );
+      }
+      CHECK( o.onDoneCount == 1 );
+    }
+
+    SECTION( "buffer with a smaller skip emits overlapping batches" )
+    {
+      out_stream_t batched;
+      batched.subscribe( o );
+      {
+        stream_t s;
+        batched = buffer( s, 3, 1 );
+
+        for( int i = 1; i <= 5; ++i )
+          s << i;
+        CHECK( o.batches == batches_t{ { 1, 2, 3 }, { 2, 3, 4 }, { 3, 4, 5 } } );
+      }
+      CHECK( o.batches == batches_t{ { 1, 2, 3 }, { 2, 3, 4 }, { 3, 4, 5 }, { 4, 5 }, { 5 } } );
+    }
+
+    SECTION( "buffer with a larger skip drops the events in between" )
+    {
+      stream_t s;
+      auto buffered = buffer( s, 2, 3 );
+      buffered.subscribe( o );
+
+      for( int i = 1; i <= 8; ++i )
+        s << i;
+      CHECK( o.batches == batches_t{ { 1, 2 }, { 4, 5 }, { 7, 8 } } );
+    }
+
+    SECTION( "buffer passes batches pushed via push_events on" )
+    {
+      stream_t s;
+      auto buffered = buffer( s, 2 );
+      buffered.subscribe( o );
+
+      std::vector< int > events = { 1, 2, 3, 4 };
+      s.push_events( events );
+      CHECK( o.batches == batches_t{ { 1, 2 }, { 3, 4 } } );
+    }
+
+    SECTION( "window emits non-overlapping windows" )
+    {
+      {
+        out_stream_t batched;
+        batched.subscribe( o );
+        {
+          stream_t s;
+          batched = window( s, 3 );
+
+          for( int i = 1; i <= 7; ++i )
+            s << i;
+          CHECK( o.batches == batches_t{ { 1, 2, 3 }, { 4, 5, 6 } } );
+        }
+        CHECK( o.batches == batches_t{ { 1, 2, 3 }, { 4, 5, 6 }, { 7 } } );
+      }
+      CHECK( o.onDoneCount == 1 );
+    }
+
+    SECTION( "sliding_window slides over the latest events" )
+    {
+      {
+        out_stream_t batched;
+        batched.subscribe( o );
+        {
+          stream_t s;
+          batched = sliding_window( s, 3 );
+
+          for( int i = 1; i <= 8; ++i )
+            s << i;
+          CHECK( o.batches == batches_t{ { 1, 2, 3 }, { 2, 3, 4 }, { 3, 4, 5 }, { 4, 5, 6 }, { 5, 6, 7 }, { 6, 7, 8 } } );
+        }
+        CHECK( o.batches.size() == 6 );
+      }
+      CHECK( o.onDoneCount == 1 );
+    }
+
+    SECTION( "sliding_window flushes a window that never got full on done" )
+    {
+      {
+        out_stream_t batched;
+        batched.subscribe( o );
+        {
+          stream_t s;
+          batched = sliding_window( s, 3 );
+          s << 1 << 2;
+        }
+        CHECK( o.batches == batches_t{ { 1, 2 } } );
+      }
+      CHECK( o.onDoneCount == 1 );
+    }
+
+    SECTION( "Copying a buffered basic_stream duplicates the buffer" )
+    {
+      stream_t s;
+      auto buffered = buffer( s, 2 );
+      s << 1;
+
+      auto copy = buffered;
+      copy.subscribe( o );
+      s << 2 << 3;
+
+      // the copy starts with an empty batch
+      CHECK( o.batches == batches_t{ { 2, 3 } } );
+    }
+  }
 }
 }
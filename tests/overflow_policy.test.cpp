@@ -0,0 +1,244 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/basic_async_stream.h>
+#include <mvd/streams/overflow_policy.h>
+#include <mvd/streams/spsc_queue.h>
+
+#include <chrono>
+#include <future>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "Overflow policies (basic_async_stream)" )
+  {
+    struct test_observer : basic_observer< int, access_policy::none >
+    {
+      void on_event( int& v_ ) final { receivedValues.push_back( v_ ); }
+      void on_done() final {}
+
+      std::vector< int > receivedValues;
+    };
+
+    using stream_t = basic_async_stream< int, access_policy::none >;
+
+    SECTION( "drop_newest discards events that don't fit and counts them" )
+    {
+      stream_t s( 2u );
+      test_observer o;
+      s.subscribe( o );
+
+      s << 1 << 2 << 3 << 4;
+      s.dispatch_events();
+
+      CHECK( o.receivedValues == std::vector< int >{ 1, 2 } );
+      CHECK( s.get_overflow_statistics().dropped() == 2 );
+    }
+
+    SECTION( "drop_oldest makes room for new events" )
+    {
+      stream_t s( 2u );
+      s.set_overflow_policy( overflow_policy< int >::drop_oldest() );
+      test_observer o;
+      s.subscribe( o );
+
+      s << 1 << 2 << 3 << 4;
+      s.dispatch_events();
+
+      CHECK( o.receivedValues == std::vector< int >{ 3, 4 } );
+      CHECK( s.get_overflow_statistics().dropped() == 2 );
+    }
+
+    SECTION( "block drops the event once the timeout expired" )
+    {
+      stream_t s( 1u );
+      s.set_overflow_policy( overflow_policy< int >::block( std::chrono::milliseconds( 1 ) ) );
+      test_observer o;
+      s.subscribe( o );
+
+      s << 1 << 2;
+      s.dispatch_events();
+
+      CHECK( o.receivedValues == std::vector< int >{ 1 } );
+      CHECK( s.get_overflow_statistics().dropped() == 1 );
+    }
+
+    SECTION( "block waits for the consumer to make room" )
+    {
+      basic_async_stream< int, access_policy::none, spsc_queue > s( 1u );
+      s.set_overflow_policy( overflow_policy< int >::block( std::chrono::seconds( 10 ) ) );
+      test_observer o;
+      s.subscribe( o );
+
+      s << 1;
+      auto consumer = std::async( std::launch::async, [&s, &o]()
+      {
+        while( o.receivedValues.size() < 3 )
+          s.dispatch_events();
+      });
+      s << 2 << 3;
+      consumer.get();
+
+      CHECK( o.receivedValues == std::vector< int >{ 1, 2, 3 } );
+      CHECK( s.get_overflow_statistics().dropped() == 0 );
+    }
+
+    SECTION( "grow enlarges the queue up to the limit" )
+    {
+      stream_t s( 2u );
+      s.set_overflow_policy( overflow_policy< int >::grow( 5u ) );
+      test_observer o;
+      s.subscribe( o );
+
+      for( int i = 0; i < 7; ++i )
+        s << i;
+      s.dispatch_events();
+
+      CHECK( o.receivedValues == std::vector< int >{ 0, 1, 2, 3, 4 } );
+      CHECK( s.get_overflow_statistics().grown() == 2 );
+      CHECK( s.get_overflow_statistics().dropped() == 2 );
+    }
+
+    SECTION( "reject hands events that don't fit to the callback" )
+    {
+      stream_t s( 1u );
+      auto rejected = std::vector< int >();
+      s.set_overflow_policy( overflow_policy< int >::reject( [&rejected]( const int& e_ ) { rejected.push_back( e_ ); } ) );
+
+      s << 1 << 2 << 3;
+
+      CHECK( rejected == std::vector< int >{ 2, 3 } );
+      CHECK( s.get_overflow_statistics().rejected() == 2 );
+      CHECK( s.get_overflow_statistics().dropped() == 0 );
+    }
+
+    SECTION( "Batches are subject to the policy as well" )
+    {
+      stream_t s( 2u );
+      test_observer o;
+      s.subscribe( o );
+
+      auto events = std::vector< int >{ 1, 2, 3 };
+      s.push_events( events );
+      s.dispatch_events();
+
+      CHECK( o.receivedValues == std::vector< int >{ 1, 2 } );
+      CHECK( s.get_overflow_statistics().dropped() == 1 );
+    }
+
+    SECTION( "Copying a stream copies the counters" )
+    {
+      stream_t s1( 1u );
+      s1 << 1 << 2;
+
+      auto s2 = s1;
+      CHECK( s2.get_overflow_statistics().dropped() == 1 );
+    }
+  }
+
+
+  TEST_CASE( "Overflow policies (basic_async_observer)" )
+  {
+    using stream_t = basic_stream< int, access_policy::none >;
+
+    auto collect = []( auto& o_ )
+    {
+      auto values = std::vector< int >();
+      o_.process_events( [&values]( int e_ ) { values.push_back( e_ ); } );
+      return values;
+    };
+
+    SECTION( "drop_newest counts the events that don't fit" )
+    {
+      stream_t s;
+      basic_async_observer< int, access_policy::none, spsc_queue > o( 2u );
+      s.subscribe( o );
+
+      s << 1 << 2 << 3 << 4;
+
+      CHECK( collect( o ) == std::vector< int >{ 1, 2 } );
+      CHECK( o.get_overflow_statistics().dropped() == 2 );
+    }
+
+    SECTION( "drop_oldest makes room for new events" )
+    {
+      stream_t s;
+      basic_async_observer< int, access_policy::none > o( 2u );
+      o.set_overflow_policy( overflow_policy< int >::drop_oldest() );
+      s.subscribe( o );
+
+      s << 1 << 2 << 3;
+
+      CHECK( collect( o ) == std::vector< int >{ 2, 3 } );
+      CHECK( o.get_overflow_statistics().dropped() == 1 );
+    }
+
+    SECTION( "reject hands events that don't fit to the callback" )
+    {
+      stream_t s;
+      basic_async_observer< int, access_policy::none, spsc_queue > o( 1u );
+      auto rejected = std::vector< int >();
+      o.set_overflow_policy( overflow_policy< int >::reject( [&rejected]( const int& e_ ) { rejected.push_back( e_ ); } ) );
+      s.subscribe( o );
+
+      s << 1 << 2;
+
+      CHECK( rejected == std::vector< int >{ 2 } );
+      CHECK( o.get_overflow_statistics().rejected() == 1 );
+    }
+  }
+
+
+  TEST_CASE( "default_queue grow" )
+  {
+    SECTION( "Queued events are kept in order when growing" )
+    {
+      default_queue< int > q( 3u );
+      int e = 0;
+      q.push( 0 );
+      q.push( 1 );
+      q.pop( e );
+      q.push( 2 );
+      q.push( 3 );
+
+      REQUIRE( q.grow( 100u ) );
+      CHECK( q.capacity() == 6 );
+      q.push( 4 );
+
+      auto values = std::vector< int >();
+      while( q.pop( e ) )
+        values.push_back( e );
+      CHECK( values == std::vector< int >{ 1, 2, 3, 4 } );
+    }
+
+    SECTION( "Doesn't grow beyond the limit" )
+    {
+      default_queue< int > q( 4u );
+      CHECK( q.grow( 6u ) );
+      CHECK( q.capacity() == 6 );
+      CHECK( !q.grow( 6u ) );
+    }
+  }
+
+}
+}
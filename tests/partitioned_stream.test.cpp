@@ -0,0 +1,150 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/partitioned_stream.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  namespace
+  {
+    struct keyed_event
+    {
+      size_t key;
+      int sequence;
+    };
+
+    // records the events per key, can be notified concurrently
+    struct recording_observer : basic_observer< keyed_event, access_policy::copy_on_write >
+    {
+      void on_event( keyed_event& e_ ) final
+      {
+        std::lock_guard< std::mutex > l( mutex );
+        sequences[ e_.key ].push_back( e_.sequence );
+        threads.insert( std::this_thread::get_id() );
+        count.fetch_add( 1 );
+      }
+      void on_done() final {}
+
+      bool wait_for_count( size_t count_ ) const
+      {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+        while( count.load() < count_ )
+        {
+          if( std::chrono::steady_clock::now() > deadline )
+            return false;
+          std::this_thread::yield();
+        }
+        return true;
+      }
+
+      std::mutex mutex;
+      std::map< size_t, std::vector< int > > sequences;
+      std::set< std::thread::id > threads;
+      std::atomic< size_t > count{ 0 };
+    };
+
+    size_t key_of( const keyed_event& e_ ) { return e_.key; }
+  }
+
+
+  TEST_CASE( "partitioned_stream" )
+  {
+    using stream_t = partitioned_stream< keyed_event >;
+
+    SECTION( "Events with the same key are dispatched in order" )
+    {
+      const size_t keyCount = 32;
+      const int eventsPerKey = 500;
+
+      recording_observer o;
+      stream_t s( 4, 1024, key_of );
+      s.set_overflow_policy( overflow_policy< keyed_event >::block( std::chrono::seconds( 10 ) ) );
+      s.subscribe( o );
+      CHECK( s.shard_count() == 4 );
+
+      // each producer pushes the events of every other key
+      auto produce = [&]( size_t first_ )
+      {
+        for( int i = 0; i < eventsPerKey; ++i )
+          for( size_t k = first_; k < keyCount; k += 2 )
+            s << keyed_event{ k, i };
+      };
+      std::thread p1( produce, 0 ), p2( produce, 1 );
+      p1.join();
+      p2.join();
+
+      REQUIRE( o.wait_for_count( keyCount * eventsPerKey ) );
+
+      std::lock_guard< std::mutex > l( o.mutex );
+      REQUIRE( o.sequences.size() == keyCount );
+      for( auto& keySequences : o.sequences )
+      {
+        auto& sequences = keySequences.second;
+        REQUIRE( sequences.size() == static_cast< size_t >( eventsPerKey ) );
+        for( int i = 0; i < eventsPerKey; ++i )
+          CHECK( sequences[i] == i );
+      }
+
+      // none of the events was dispatched on a producer thread
+      CHECK( o.threads.size() > 1 );
+      CHECK( o.threads.size() <= s.shard_count() );
+      CHECK( o.threads.count( std::this_thread::get_id() ) == 0 );
+    }
+
+    SECTION( "Batches are spread over the shards" )
+    {
+      recording_observer o;
+      stream_t s( 3, 64, key_of );
+      s.subscribe( o );
+
+      std::vector< keyed_event > batch = { { 1, 0 }, { 2, 0 }, { 1, 1 }, { 3, 0 }, { 2, 1 } };
+      s.push_events( batch );
+
+      REQUIRE( o.wait_for_count( batch.size() ) );
+      std::lock_guard< std::mutex > l( o.mutex );
+      CHECK( o.sequences[1] == std::vector< int >{ 0, 1 } );
+      CHECK( o.sequences[2] == std::vector< int >{ 0, 1 } );
+      CHECK( o.sequences[3] == std::vector< int >{ 0 } );
+    }
+
+    SECTION( "Queued events are dispatched before the stream is destroyed" )
+    {
+      recording_observer o;
+      {
+        stream_t s( 2, 4096, key_of );
+        s.subscribe( o );
+        for( int i = 0; i < 2000; ++i )
+          s << keyed_event{ static_cast< size_t >( i % 5 ), i };
+      }
+      CHECK( o.count == 2000 );
+    }
+  }
+}
+}
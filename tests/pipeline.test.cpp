@@ -0,0 +1,202 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/pipeline.h>
+#include <mvd/streams/access_policy.h>
+#include <mvd/streams/basic_async_stream.h>
+
+#include <string>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "pipeline basic_stream" )
+  {
+    using stream_t = basic_stream< int, access_policy::none >;
+
+    SECTION( "Sink receives filtered events only" )
+    {
+      stream_t s;
+      std::vector< int > receivedValues;
+
+      auto p = s
+        | filter( []( const int& i_ ) { return i_ % 2 == 0; } )
+        | sink( [&receivedValues]( int i_ ) { receivedValues.push_back( i_ ); } );
+
+      std::vector< int > expectedValues = { 2, 4, 16, 100 };
+      for( auto v : expectedValues )
+      {
+        s << v;
+        s << v + 1;
+      }
+
+      CHECK( receivedValues == expectedValues );
+    }
+
+    SECTION( "Sink receives mapped events" )
+    {
+      stream_t s;
+      std::vector< std::string > receivedValues;
+
+      auto p = s
+        | map( []( const int& i_ ) { return std::to_string( i_ ); } )
+        | sink( [&receivedValues]( const std::string& s_ ) { receivedValues.push_back( s_ ); } );
+
+      for( auto v : { 1, 2, 42 } )
+        s << v;
+
+      CHECK( receivedValues == std::vector< std::string >{ "1", "2", "42" } );
+    }
+
+    SECTION( "Multi-stage pipeline applies all stages in order" )
+    {
+      stream_t s;
+      std::vector< double > receivedValues;
+
+      auto p = s
+        | filter( []( int i_ ) { return i_ > 0; } )
+        | map( []( int i_ ) { return i_ * 3; } )
+        | filter( []( int i_ ) { return i_ % 2 == 0; } )
+        | map( []( int i_ ) { return i_ / 2.0; } )
+        | sink( [&receivedValues]( double d_ ) { receivedValues.push_back( d_ ); } );
+
+      for( auto v : { -4, 1, 2, 3, 4 } )
+        s << v;
+
+      CHECK( receivedValues == std::vector< double >{ 3.0, 6.0 } );
+    }
+
+    SECTION( "Pipelines can be composed before being attached to a stream" )
+    {
+      stream_t s;
+      std::vector< int > receivedValues;
+
+      auto evenSquares = filter( []( int i_ ) { return i_ % 2 == 0; } ) | map( []( int i_ ) { return i_ * i_; } );
+      auto p = s | evenSquares | sink( [&receivedValues]( int i_ ) { receivedValues.push_back( i_ ); } );
+
+      for( auto v : { 1, 2, 3, 4 } )
+        s << v;
+
+      CHECK( receivedValues == std::vector< int >{ 4, 16 } );
+    }
+
+    SECTION( "Batches are run through the fused pipeline" )
+    {
+      stream_t s;
+      std::vector< int > receivedValues;
+
+      auto p = s
+        | filter( []( int i_ ) { return i_ % 2 == 0; } )
+        | sink( [&receivedValues]( int i_ ) { receivedValues.push_back( i_ ); } );
+
+      std::vector< int > values = { 1, 2, 3, 4 };
+      s.push_events( values );
+
+      CHECK( receivedValues == std::vector< int >{ 2, 4 } );
+    }
+
+    SECTION( "A complete pipeline subscribes a single observer to the source stream" )
+    {
+      stream_t s;
+
+      auto p = s
+        | filter( []( int ) { return true; } )
+        | map( []( int i_ ) { return i_; } )
+        | sink( []( int ) {} );
+
+      CHECK( s.get_observer_count() == 1 );
+    }
+
+    SECTION( "Destroying the pipeline unsubscribes it from the source stream" )
+    {
+      stream_t s;
+      {
+        auto p = s | sink( []( int ) {} );
+        REQUIRE( s.get_observer_count() == 1 );
+      }
+      CHECK( s.get_observer_count() == 0 );
+    }
+
+    SECTION( "The returned observer has to be kept for the pipeline to run" )
+    {
+      stream_t s;
+      std::vector< int > receivedValues;
+      auto collect = sink( [&receivedValues]( int i_ ) { receivedValues.push_back( i_ ); } );
+
+      // discarding the observer unsubscribes the pipeline right away
+      static_cast< void >( s | collect );
+      CHECK( s.get_observer_count() == 0 );
+
+      s << 1;
+      CHECK( receivedValues.empty() );
+
+      // a kept observer receives events until it goes out of scope
+      {
+        auto p = s | collect;
+        s << 2;
+      }
+      s << 3;
+
+      CHECK( receivedValues == std::vector< int >{ 2 } );
+    }
+
+    SECTION( "on_done is forwarded to the sink" )
+    {
+      stream_t s;
+      bool onDoneReceived = false;
+
+      auto p = s
+        | filter( []( int ) { return true; } )
+        | sink( []( int ) {}, [&onDoneReceived]() { onDoneReceived = true; } );
+
+      s.on_done();
+      CHECK( onDoneReceived );
+    }
+  }
+
+
+  TEST_CASE( "pipeline basic_async_stream" )
+  {
+    using stream_t = basic_async_stream< int, access_policy::none >;
+
+    SECTION( "Events are processed on dispatch" )
+    {
+      stream_t s( 100 );
+      std::vector< int > receivedValues;
+
+      auto p = s
+        | filter( []( int i_ ) { return i_ % 2 == 0; } )
+        | map( []( int i_ ) { return i_ + 1; } )
+        | sink( [&receivedValues]( int i_ ) { receivedValues.push_back( i_ ); } );
+
+      for( auto v : { 1, 2, 3, 4 } )
+        s << v;
+
+      REQUIRE( receivedValues.empty() );
+
+      s.dispatch_events();
+
+      CHECK( receivedValues == std::vector< int >{ 3, 5 } );
+    }
+  }
+}
+}
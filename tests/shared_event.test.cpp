@@ -0,0 +1,110 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/basic_async_stream.h>
+#include <mvd/streams/dispatcher.h>
+#include <mvd/streams/shared_event.h>
+#include <mvd/streams/spsc_queue.h>
+
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "shared_event" )
+  {
+    SECTION( "Copies share the event" )
+    {
+      auto e = make_shared_event< std::string, access_policy::none >( "event" );
+      CHECK( *e == "event" );
+      CHECK( e->size() == 5 );
+      CHECK( e.use_count() == 1 );
+
+      auto copy = e;
+      CHECK( copy.get() == e.get() );
+      CHECK( e.use_count() == 2 );
+
+      auto moved = std::move( copy );
+      CHECK_FALSE( copy );
+      CHECK( e.use_count() == 2 );
+
+      moved.reset();
+      CHECK( e.use_count() == 1 );
+    }
+
+    SECTION( "Async observers queue the event without copying it" )
+    {
+      using event_t = shared_event< std::array< char, 2048 >, access_policy::none >;
+      using observer_t = basic_async_observer< event_t, access_policy::none >;
+
+      basic_stream< event_t, access_policy::none > s;
+      std::vector< observer_t > observers( 30, observer_t( 4u ) );
+      for( auto& o : observers )
+        s.subscribe( o );
+
+      auto e = make_shared_event< std::array< char, 2048 >, access_policy::none >();
+      auto block = e.get();
+      s << e;
+      CHECK( e.use_count() == 31 );
+
+      for( auto& o : observers )
+        o.process_events( [block]( event_t& e_ ) { CHECK( e_.get() == block ); } );
+      CHECK( e.use_count() == 1 );
+    }
+
+    SECTION( "Events can be released on other threads with the default policy" )
+    {
+      using event_t = shared_event< std::vector< int > >;
+      using observer_t = basic_async_observer< event_t, access_policy::none, spsc_queue >;
+
+      basic_stream< event_t, access_policy::none > s;
+      observer_t o1( 1024u ), o2( 1024u );
+      s.subscribe( o1 );
+      s.subscribe( o2 );
+
+      const int eventCount = 1000;
+      auto e = make_shared_event< std::vector< int > >( 10, 1 );
+      auto consume = [eventCount]( observer_t& o_ )
+      {
+        int sum = 0, count = 0;
+        while( count < eventCount )
+          o_.process_events( [&]( event_t& e_ ) { sum += ( *e_ )[0]; ++count; } );
+        return sum;
+      };
+
+      int sum1 = 0, sum2 = 0;
+      std::thread c1( [&]() { sum1 = consume( o1 ); } );
+      std::thread c2( [&]() { sum2 = consume( o2 ); } );
+      for( int i = 0; i < eventCount; ++i )
+        s << e;
+      c1.join();
+      c2.join();
+
+      CHECK( sum1 == eventCount );
+      CHECK( sum2 == eventCount );
+      CHECK( e.use_count() == 1 );
+    }
+  }
+}
+}
@@ -0,0 +1,109 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/slab.h>
+
+#include <string>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "slab" )
+  {
+    using slab_t = slab< std::string, 4 >;
+
+    SECTION( "Emplaced objects keep their address when more objects are added" )
+    {
+      slab_t s;
+      auto& first = s.emplace( "first" );
+
+      std::vector< std::string* > objects;
+      for( size_t i = 0; i < 10; ++i )
+        objects.push_back( &s.emplace( std::to_string( i ) ) );
+
+      CHECK( first == "first" );
+      for( size_t i = 0; i < objects.size(); ++i )
+        CHECK( *objects[i] == std::to_string( i ) );
+    }
+
+    SECTION( "Erased slots are reused" )
+    {
+      slab_t s;
+      auto& a = s.emplace( "a" );
+      s.emplace( "b" );
+
+      auto* address = &a;
+      s.erase( a );
+      REQUIRE( s.size() == 1 );
+
+      auto& c = s.emplace( "c" );
+      CHECK( &c == address );
+      CHECK( s.size() == 2 );
+      CHECK( s.capacity() == 4 );
+    }
+
+    SECTION( "Erasing twice has no effect, generations tell reused slots apart" )
+    {
+      slab_t s;
+      auto& a = s.emplace( "a" );
+      auto generation = s.generation( a );
+      CHECK( s.contains( a, generation ) );
+
+      CHECK( s.erase( a ) );
+      CHECK_FALSE( s.erase( a ) );
+      CHECK( s.size() == 0 );
+      CHECK_FALSE( s.contains( a, generation ) );
+
+      auto& b = s.emplace( "b" );
+      REQUIRE( &b == &a );
+      CHECK_FALSE( s.contains( a, generation ) );
+      CHECK( s.contains( b, s.generation( b ) ) );
+      CHECK( s.size() == 1 );
+    }
+
+    SECTION( "Capacity grows chunk by chunk" )
+    {
+      slab_t s;
+      for( size_t i = 0; i < 5; ++i )
+        s.emplace( "x" );
+
+      CHECK( s.size() == 5 );
+      CHECK( s.capacity() == 8 );
+    }
+
+    SECTION( "Moving a slab keeps the objects in place" )
+    {
+      slab_t s1;
+      auto& a = s1.emplace( "a" );
+
+      slab_t s2 = std::move( s1 );
+
+      CHECK( s1.size() == 0 );
+      CHECK( s2.size() == 1 );
+      CHECK( a == "a" );
+
+      s2.erase( a );
+      CHECK( s2.size() == 0 );
+    }
+  }
+}
+}
@@ -0,0 +1,145 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/spsc_queue.h>
+#include <mvd/streams/basic_async_stream.h>
+
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "spsc_queue" )
+  {
+    SECTION( "Events are popped in FIFO order across the end of the buffer" )
+    {
+      spsc_queue< int > q( 4u );
+      int e = 0;
+
+      for( int i = 0; i < 10; ++i )
+      {
+        REQUIRE( q.push( i ) );
+        REQUIRE( q.push( i + 100 ) );
+        REQUIRE( q.pop( e ) );
+        CHECK( e == i );
+        REQUIRE( q.pop( e ) );
+        CHECK( e == i + 100 );
+      }
+      CHECK( !q.pop( e ) );
+      CHECK( q.empty() );
+    }
+
+    SECTION( "Push fails once the requested capacity is reached" )
+    {
+      spsc_queue< int > q( 3u );
+      CHECK( q.push( 1 ) );
+      CHECK( q.push( 2 ) );
+      CHECK( q.push( 3 ) );
+      CHECK( !q.push( 4 ) );
+
+      int e = 0;
+      q.pop( e );
+      CHECK( q.push( 4 ) );
+    }
+
+    SECTION( "Queued events are destroyed with the queue" )
+    {
+      auto p = std::make_shared< int >( 0 );
+      {
+        spsc_queue< std::shared_ptr< int > > q( 4u );
+        q.push( p );
+        auto moved = std::move( q );
+        CHECK( p.use_count() == 2 );
+      }
+      CHECK( p.use_count() == 1 );
+    }
+
+    SECTION( "All events arrive in order when producer and consumer run concurrently" )
+    {
+      spsc_queue< size_t > q( 64u );
+      const size_t eventCount = 100000;
+
+      auto producer = std::async( std::launch::async, [&q]()
+      {
+        for( size_t i = 0; i < eventCount; ++i )
+          while( !q.push( i ) ) {}
+      });
+
+      size_t expected = 0;
+      bool inOrder = true;
+      while( expected < eventCount )
+      {
+        q.consume_one( [&expected, &inOrder]( size_t& e_ ) { inOrder = inOrder && e_ == expected++; } );
+      }
+      producer.get();
+
+      CHECK( inOrder );
+      CHECK( q.empty() );
+    }
+  }
+
+
+  TEST_CASE( "basic_async_stream (spsc queue)" )
+  {
+    struct test_observer : basic_observer< int, access_policy::none >
+    {
+      void on_event( int& v_ ) final { receivedValues.push_back( v_ ); }
+      void on_done() final {}
+
+      std::vector< int > receivedValues;
+    };
+
+    SECTION( "Events pushed on one thread are dispatched on another" )
+    {
+      basic_async_stream< int, access_policy::none, spsc_queue > stream( 1024u );
+      test_observer o;
+      stream.subscribe( o );
+
+      std::async( std::launch::async, [&stream]()
+      {
+        for( int i = 0; i < 100; ++i )
+          stream << i;
+      }).get();
+
+      CHECK( o.receivedValues.empty() );
+      stream.dispatch_events();
+      REQUIRE( o.receivedValues.size() == 100 );
+      CHECK( o.receivedValues.back() == 99 );
+    }
+
+    SECTION( "Can be used as the queue of an async observer" )
+    {
+      basic_stream< int, access_policy::none > stream;
+      basic_async_observer< int, access_policy::none, spsc_queue > o( 16u );
+      stream.subscribe( o );
+
+      stream << 1 << 2;
+
+      auto received = std::vector< int >();
+      o.process_events( [&received]( const int& e_ ) { received.push_back( e_ ); } );
+      CHECK( received == std::vector< int >{ 1, 2 } );
+    }
+  }
+
+}
+}
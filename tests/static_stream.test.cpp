@@ -0,0 +1,94 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/static_stream.h>
+#include <mvd/streams/basic_stream.h>
+
+#include <string>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "static_stream" )
+  {
+    struct recording_observer
+    {
+      void on_event( int& e_ ) { receivedValues.push_back( e_ ); }
+      void on_done() { onDoneReceived = true; }
+
+      std::vector< int > receivedValues;
+      bool onDoneReceived = false;
+    };
+
+    struct summing_observer final : basic_observer< int, access_policy::none >
+    {
+      void on_event( int& e_ ) final { sum += e_; }
+      void on_done() final {}
+
+      int sum = 0;
+    };
+
+    SECTION( "All observers receive the events in order" )
+    {
+      recording_observer o1, o2;
+      auto s = make_static_stream< int >( o1, o2 );
+      static_assert( decltype( s )::observer_count() == 2, "" );
+
+      s << 1 << 2 << 3;
+
+      CHECK( o1.receivedValues == std::vector< int >{ 1, 2, 3 } );
+      CHECK( o2.receivedValues == std::vector< int >{ 1, 2, 3 } );
+    }
+
+    SECTION( "Observers of different types can be mixed" )
+    {
+      recording_observer o1;
+      summing_observer o2;
+      auto s = make_static_stream< int >( o1, o2 );
+
+      int values[] = { 1, 2, 4 };
+      s.push_events( values );
+
+      CHECK( o1.receivedValues == std::vector< int >{ 1, 2, 4 } );
+      CHECK( o2.sum == 7 );
+    }
+
+    SECTION( "on_done is passed on to all observers" )
+    {
+      recording_observer o1, o2;
+      auto s = make_static_stream< int >( o1, o2 );
+      s.on_done();
+
+      CHECK( o1.onDoneReceived );
+      CHECK( o2.onDoneReceived );
+    }
+
+    SECTION( "Stream without observers discards events" )
+    {
+      auto s = make_static_stream< int >();
+      s << 1;
+      CHECK( s.observer_count() == 0 );
+    }
+  }
+
+}
+}
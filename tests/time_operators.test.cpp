@@ -0,0 +1,175 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/time_operators.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "Time operators" )
+  {
+    using namespace std::chrono;
+    using stream_t = basic_stream< int, access_policy::none >;
+
+    const auto start = timer_wheel::clock_t::now();
+    timer_wheel wheel( milliseconds( 1 ), start );
+    auto at = [start]( int ms_ ) { return start + milliseconds( ms_ ); };
+
+    stream_t s;
+    std::vector< int > received;
+
+    SECTION( "delay" )
+    {
+      auto delayed = delay( s, wheel, milliseconds( 10 ) );
+      delayed.subscribe( [&received]( int v_ ) { received.push_back( v_ ); } );
+
+      s << 1;
+      wheel.advance( at( 5 ) );
+      s << 2;
+      wheel.advance( at( 9 ) );
+      CHECK( received.empty() );
+
+      wheel.advance( at( 10 ) );
+      CHECK( received == std::vector< int >{ 1 } );
+      wheel.advance( at( 15 ) );
+      CHECK( received == std::vector< int >{ 1, 2 } );
+    }
+
+    SECTION( "timeout" )
+    {
+      auto guarded = timeout( s, wheel, milliseconds( 10 ), -1 );
+      guarded.subscribe( [&received]( int v_ ) { received.push_back( v_ ); } );
+
+      wheel.advance( at( 5 ) );
+      s << 1;
+      wheel.advance( at( 14 ) );
+      CHECK( received == std::vector< int >{ 1 } );
+
+      // emitted once per silence
+      wheel.advance( at( 15 ) );
+      wheel.advance( at( 100 ) );
+      CHECK( received == std::vector< int >{ 1, -1 } );
+
+      s << 2;
+      wheel.advance( at( 110 ) );
+      CHECK( received == std::vector< int >{ 1, -1, 2, -1 } );
+    }
+
+    SECTION( "debounce" )
+    {
+      auto debounced = debounce( s, wheel, milliseconds( 10 ) );
+      debounced.subscribe( [&received]( int v_ ) { received.push_back( v_ ); } );
+
+      s << 1;
+      wheel.advance( at( 5 ) );
+      s << 2;
+      wheel.advance( at( 14 ) );
+      CHECK( received.empty() );
+
+      wheel.advance( at( 15 ) );
+      CHECK( received == std::vector< int >{ 2 } );
+
+      s << 3;
+      wheel.advance( at( 100 ) );
+      CHECK( received == std::vector< int >{ 2, 3 } );
+    }
+
+    SECTION( "throttle_first" )
+    {
+      auto throttled = throttle_first( s, wheel, milliseconds( 10 ) );
+      throttled.subscribe( [&received]( int v_ ) { received.push_back( v_ ); } );
+
+      s << 1 << 2;
+      wheel.advance( at( 9 ) );
+      s << 3;
+      wheel.advance( at( 10 ) );
+      s << 4 << 5;
+      CHECK( received == std::vector< int >{ 1, 4 } );
+    }
+
+    SECTION( "throttle_last" )
+    {
+      auto throttled = throttle_last( s, wheel, milliseconds( 10 ) );
+      throttled.subscribe( [&received]( int v_ ) { received.push_back( v_ ); } );
+
+      s << 1 << 2;
+      wheel.advance( at( 9 ) );
+      s << 3;
+      CHECK( received.empty() );
+
+      wheel.advance( at( 10 ) );
+      CHECK( received == std::vector< int >{ 3 } );
+
+      wheel.advance( at( 50 ) );
+      s << 4;
+      wheel.advance( at( 60 ) );
+      CHECK( received == std::vector< int >{ 3, 4 } );
+    }
+
+    SECTION( "sample" )
+    {
+      auto sampled = sample( s, wheel, milliseconds( 10 ) );
+      sampled.subscribe( [&received]( int v_ ) { received.push_back( v_ ); } );
+
+      s << 1 << 2;
+      wheel.advance( at( 10 ) );
+      CHECK( received == std::vector< int >{ 2 } );
+
+      // nothing new, nothing sampled
+      wheel.advance( at( 20 ) );
+      CHECK( received == std::vector< int >{ 2 } );
+
+      s << 3;
+      wheel.advance( at( 25 ) );
+      s << 4;
+      wheel.advance( at( 30 ) );
+      CHECK( received == std::vector< int >{ 2, 4 } );
+    }
+
+    SECTION( "Destroying the operator stream cancels its timers" )
+    {
+      {
+        auto delayed = delay( s, wheel, milliseconds( 10 ) );
+        s << 1;
+        CHECK( wheel.size() == 1 );
+      }
+      CHECK( wheel.size() == 0 );
+      wheel.advance( at( 10 ) );
+    }
+
+    SECTION( "A copied operator stream keeps its own timers" )
+    {
+      auto delayed = delay( s, wheel, milliseconds( 10 ) );
+      auto copy = delayed;
+      copy.subscribe( [&received]( int v_ ) { received.push_back( v_ ); } );
+
+      s << 1;
+      CHECK( wheel.size() == 2 );
+      wheel.advance( at( 10 ) );
+      CHECK( received == std::vector< int >{ 1 } );
+    }
+  }
+}
+}
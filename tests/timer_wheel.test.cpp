@@ -0,0 +1,156 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/timer_wheel.h>
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  TEST_CASE( "timer_wheel" )
+  {
+    using namespace std::chrono;
+
+    const auto start = timer_wheel::clock_t::now();
+    timer_wheel wheel( milliseconds( 1 ), start );
+    std::vector< int > fired;
+
+    SECTION( "Timers fire once their deadline has been reached, in order" )
+    {
+      wheel.schedule( milliseconds( 30 ), [&fired]() { fired.push_back( 30 ); } );
+      wheel.schedule( milliseconds( 10 ), [&fired]() { fired.push_back( 10 ); } );
+      wheel.schedule( milliseconds( 20 ), [&fired]() { fired.push_back( 20 ); } );
+      CHECK( wheel.size() == 3 );
+
+      CHECK( wheel.advance( start + milliseconds( 9 ) ) == 0 );
+      CHECK( wheel.advance( start + milliseconds( 20 ) ) == 2 );
+      CHECK( fired == std::vector< int >{ 10, 20 } );
+      CHECK( wheel.now() == start + milliseconds( 20 ) );
+
+      CHECK( wheel.advance( start + milliseconds( 100 ) ) == 1 );
+      CHECK( fired == std::vector< int >{ 10, 20, 30 } );
+      CHECK( wheel.size() == 0 );
+    }
+
+    SECTION( "Deadlines between ticks are rounded up" )
+    {
+      wheel.schedule( start + microseconds( 1500 ), [&fired]() { fired.push_back( 1 ); } );
+
+      wheel.advance( start + microseconds( 1999 ) );
+      CHECK( fired.empty() );
+      wheel.advance( start + milliseconds( 2 ) );
+      CHECK( fired.size() == 1 );
+    }
+
+    SECTION( "Cancelled timers don't fire" )
+    {
+      auto t1 = wheel.schedule( milliseconds( 10 ), [&fired]() { fired.push_back( 1 ); } );
+      wheel.schedule( milliseconds( 10 ), [&fired]() { fired.push_back( 2 ); } );
+
+      CHECK( wheel.cancel( t1 ) );
+      CHECK_FALSE( wheel.cancel( t1 ) );
+      CHECK( wheel.size() == 1 );
+
+      wheel.advance( start + milliseconds( 10 ) );
+      CHECK( fired == std::vector< int >{ 2 } );
+    }
+
+    SECTION( "A fired timer can't be cancelled, even if its slot has been reused" )
+    {
+      auto t1 = wheel.schedule( milliseconds( 1 ), [&fired]() { fired.push_back( 1 ); } );
+      wheel.advance( start + milliseconds( 1 ) );
+
+      wheel.schedule( milliseconds( 1 ), [&fired]() { fired.push_back( 2 ); } );
+      CHECK_FALSE( wheel.cancel( t1 ) );
+
+      wheel.advance( start + milliseconds( 2 ) );
+      CHECK( fired == std::vector< int >{ 1, 2 } );
+    }
+
+    SECTION( "Timers on the higher levels are cascaded down" )
+    {
+      // level 1, 2 and 3, and one beyond the range of the wheel
+      for( long long delay : { 300ll, 70000ll, 20000000ll, 5000000000ll } )
+      {
+        int id = delay > 1000000000 ? -1 : static_cast< int >( delay );
+        wheel.schedule( milliseconds( delay ), [&fired, id]() { fired.push_back( id ); } );
+      }
+
+      wheel.advance( start + milliseconds( 299 ) );
+      CHECK( fired.empty() );
+      wheel.advance( start + milliseconds( 300 ) );
+      CHECK( fired == std::vector< int >{ 300 } );
+
+      wheel.advance( start + milliseconds( 69999 ) );
+      CHECK( fired.size() == 1 );
+      wheel.advance( start + milliseconds( 70000 ) );
+      CHECK( fired.size() == 2 );
+
+      wheel.advance( start + milliseconds( 19999999 ) );
+      CHECK( fired.size() == 2 );
+      wheel.advance( start + milliseconds( 20000000 ) );
+      CHECK( fired == std::vector< int >{ 300, 70000, 20000000 } );
+
+      wheel.advance( start + milliseconds( 4999999999 ) );
+      CHECK( fired.size() == 3 );
+      wheel.advance( start + milliseconds( 5000000000 ) );
+      CHECK( fired.back() == -1 );
+    }
+
+    SECTION( "Callbacks can schedule new timers" )
+    {
+      int count = 0;
+      std::function< void() > rearm = [&]()
+      {
+        if( ++count < 5 )
+          wheel.schedule( milliseconds( 0 ), [&rearm]() { rearm(); } );
+      };
+      wheel.schedule( milliseconds( 1 ), [&rearm]() { rearm(); } );
+
+      // a timer scheduled for now fires on the next tick
+      wheel.advance( start + milliseconds( 1 ) );
+      CHECK( count == 1 );
+      wheel.advance( start + milliseconds( 10 ) );
+      CHECK( count == 5 );
+    }
+
+    SECTION( "Many timers" )
+    {
+      const int timerCount = 100000;
+      int count = 0;
+      std::vector< timer_wheel::timer_id > ids;
+      for( int i = 0; i < timerCount; ++i )
+        ids.push_back( wheel.schedule( milliseconds( i % 5000 + 1 ), [&count]() { ++count; } ) );
+
+      for( int i = 0; i < timerCount; i += 2 )
+        wheel.cancel( ids[i] );
+      CHECK( wheel.size() == timerCount / 2 );
+
+      wheel.advance( start + seconds( 5 ) );
+      CHECK( count == timerCount / 2 );
+      CHECK( wheel.size() == 0 );
+    }
+  }
+}
+}
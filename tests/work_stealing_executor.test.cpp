@@ -0,0 +1,173 @@
+/*************************************************************************************************************
+
+ mvd streams
+
+
+ Copyright 2019 mvd
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in
+ compliance with the License. You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software distributed under the License is
+ distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and limitations under the License.
+
+*************************************************************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <mvd/streams/basic_async_stream.h>
+#include <mvd/streams/mpsc_queue.h>
+#include <mvd/streams/work_stealing_executor.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mvd
+{
+namespace streams
+{
+  namespace
+  {
+    // checks the order of the events and that no two workers dispatch to it at once
+    struct ordered_observer : basic_observer< int, access_policy::none >
+    {
+      void on_event( int& v_ ) final
+      {
+        if( inFlight.fetch_add( 1 ) != 0 )
+          overlapped = true;
+        if( v_ != next )
+          outOfOrder = true;
+        next = v_ + 1;
+        inFlight.fetch_sub( 1 );
+        count.fetch_add( 1 );
+      }
+      void on_done() final {}
+
+      int next = 0;
+      std::atomic< int > inFlight{ 0 };
+      std::atomic< bool > overlapped{ false };
+      std::atomic< bool > outOfOrder{ false };
+      std::atomic< size_t > count{ 0 };
+    };
+
+    bool wait_for_count( const ordered_observer& o_, size_t count_ )
+    {
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+      while( o_.count.load() < count_ )
+      {
+        if( std::chrono::steady_clock::now() > deadline )
+          return false;
+        std::this_thread::yield();
+      }
+      return true;
+    }
+  }
+
+
+  TEST_CASE( "work_stealing_executor" )
+  {
+    using stream_t = basic_async_stream< int, access_policy::none, mpsc_queue >;
+
+    SECTION( "Events of many streams are dispatched in order" )
+    {
+      const size_t streamCount = 16;
+      const int eventCount = 1000;
+
+      work_stealing_executor e( 4 );
+      CHECK( e.worker_count() == 4 );
+
+      std::vector< std::unique_ptr< stream_t > > streams;
+      std::vector< std::unique_ptr< ordered_observer > > observers;
+      for( size_t i = 0; i < streamCount; ++i )
+      {
+        streams.push_back( std::make_unique< stream_t >( 1024u ) );
+        observers.push_back( std::make_unique< ordered_observer >() );
+        streams.back()->subscribe( *observers.back() );
+        streams.back()->set_executor( &e );
+      }
+
+      // two producers, each with its own half of the streams
+      auto produce = [&]( size_t first_ )
+      {
+        for( int v = 0; v < eventCount; ++v )
+          for( size_t i = first_; i < streamCount; i += 2 )
+            *streams[i] << v;
+      };
+      std::thread p1( produce, 0 ), p2( produce, 1 );
+      p1.join();
+      p2.join();
+
+      for( auto& o : observers )
+      {
+        REQUIRE( wait_for_count( *o, eventCount ) );
+        CHECK_FALSE( o->overlapped );
+        CHECK_FALSE( o->outOfOrder );
+      }
+
+      for( auto& s : streams )
+        s->set_executor( nullptr );
+    }
+
+    SECTION( "A stream can be detached while events are dispatched" )
+    {
+      work_stealing_executor e( 2 );
+      ordered_observer o;
+      stream_t s( 1024u );
+      s.subscribe( o );
+      s.set_executor( &e );
+
+      for( int v = 0; v < 500; ++v )
+        s << v;
+      s.set_executor( nullptr );
+
+      auto count = o.count.load();
+      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      CHECK( o.count == count );
+
+      // the remaining events are still in the queue
+      s.dispatch_events();
+      CHECK( o.count == 500 );
+      CHECK_FALSE( o.outOfOrder );
+    }
+
+    SECTION( "Destroyed streams are detached" )
+    {
+      work_stealing_executor e( 2 );
+      ordered_observer o;
+      for( int i = 0; i < 10; ++i )
+      {
+        stream_t s( 64u );
+        s.subscribe( o );
+        s.set_executor( &e );
+        s << 0;
+      }
+      e.stop();
+      CHECK( o.count <= 10 );
+    }
+
+    SECTION( "Stopping the executor runs the pending work" )
+    {
+      ordered_observer o;
+      stream_t s( 1024u );
+      s.subscribe( o );
+      {
+        work_stealing_executor e( 3 );
+        s.set_executor( &e );
+        for( int v = 0; v < 500; ++v )
+          s << v;
+        e.stop();
+        s.set_executor( nullptr );
+      }
+      CHECK( o.count == 500 );
+      CHECK_FALSE( o.outOfOrder );
+    }
+  }
+
+}
+}